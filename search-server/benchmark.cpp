@@ -0,0 +1,603 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+
+#include "generators.h"
+#include "mutation_log.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+namespace {
+
+struct Corpus {
+    vector<string> dictionary;
+    vector<string> documents;
+};
+
+template <typename Function>
+double MeasureNs(Function&& function) {
+    const auto start = chrono::steady_clock::now();
+    function();
+    return static_cast<double>(
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+// Body records its samples into the given vector. Warmup runs go to a scratch vector.
+template <typename Body>
+vector<double> CollectSamples(const BenchmarkConfig& config, Body&& body) {
+    vector<double> scratch;
+    for (int i = 0; i < config.warmup; ++i) {
+        body(scratch);
+        scratch.clear();
+    }
+    vector<double> samples;
+    for (int i = 0; i < config.repetitions; ++i) {
+        body(samples);
+    }
+    return samples;
+}
+
+void LoadServer(SearchServer& search_server, const vector<string>& documents) {
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+}
+
+class MuteStdout {
+public:
+    MuteStdout()
+        : buffer_(cout.rdbuf(nullptr)) {
+    }
+
+    ~MuteStdout() {
+        cout.rdbuf(buffer_);
+    }
+
+private:
+    streambuf* buffer_;
+};
+
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(const BenchmarkConfig& config, const Corpus& corpus, int document_count, double zipf_exponent)
+        : config_(config)
+        , corpus_(corpus)
+        , document_count_(document_count)
+        , zipf_exponent_(zipf_exponent) {
+    }
+
+    void Run(vector<BenchmarkResult>& results) {
+        RunAddDocument(results);
+        RunBulkLoad(results);
+        RunAllocation(false, "heap"s, results);
+        RunAllocation(true, "pool"s, results);
+        RunIngest(nullopt, "no_log"s, results);
+        RunIngest(MutationLogOptions{}, "group_commit"s, results);
+        RunIngest(MutationLogOptions{ chrono::microseconds(0), 0, true }, "commit_each"s, results);
+        RunRemoveDocument(execution::seq, "seq"s, results);
+        RunRemoveDocument(execution::par, "par"s, results);
+        RunRemoveCommonWord(true, "lowest_first"s, results);
+        RunRemoveCommonWord(false, "highest_first"s, results);
+        RunRemoveDuplicates(results);
+        RunUpdateDocument("remove_add"s, results);
+        RunUpdateDocument("update_text"s, results);
+        RunUpdateDocument("update_metadata"s, results);
+
+        SearchServer search_server(corpus_.dictionary[0]);
+        LoadServer(search_server, corpus_.documents);
+        mt19937 generator(config_.seed + 1);
+        const ZipfDistribution distribution(corpus_.dictionary.size(), zipf_exponent_);
+        for (const double minus_ratio : config_.minus_ratios) {
+            const auto queries = GenerateZipfQueries(generator, corpus_.dictionary, distribution,
+                config_.query_count, config_.words_per_query, minus_ratio);
+            RunFindTopDocuments(search_server, queries, minus_ratio, execution::seq, "seq"s, results);
+            RunFindTopDocuments(search_server, queries, minus_ratio, execution::par, "par"s, results);
+            RunFindTopDocumentsWithContext(search_server, queries, minus_ratio, results);
+            RunMatchDocument(search_server, queries, minus_ratio, execution::seq, "seq"s, results);
+            RunMatchDocument(search_server, queries, minus_ratio, execution::par, "par"s, results);
+            RunProcessQueries(search_server, queries, minus_ratio, results);
+        }
+        RunPhraseSearch(search_server, results);
+        RunTypoSearch(search_server, results);
+        RunScoring(search_server, results);
+        RunConjunctive(search_server, results);
+    }
+
+private:
+    const BenchmarkConfig& config_;
+    const Corpus& corpus_;
+    int document_count_;
+    double zipf_exponent_;
+
+    void AddResult(vector<BenchmarkResult>& results, string name, string policy, double minus_ratio,
+        size_t batch_size, vector<double> samples, double checksum, size_t memory_bytes = 0) const {
+        BenchmarkResult result;
+        result.name = move(name);
+        result.policy = move(policy);
+        result.document_count = document_count_;
+        result.zipf_exponent = zipf_exponent_;
+        result.minus_ratio = minus_ratio;
+        result.batch_size = batch_size;
+        result.stats = ComputeBenchmarkStats(move(samples), batch_size);
+        result.checksum = checksum;
+        result.memory_bytes = memory_bytes;
+        results.push_back(move(result));
+    }
+
+    void RunAddDocument(vector<BenchmarkResult>& results) const {
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            SearchServer search_server(corpus_.dictionary[0]);
+            for (size_t i = 0; i < corpus_.documents.size(); ++i) {
+                out.push_back(MeasureNs([&] {
+                    search_server.AddDocument(static_cast<int>(i), corpus_.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                }));
+            }
+            checksum = search_server.GetDocumentCount();
+        });
+        AddResult(results, "add_document"s, "seq"s, 0, 1, move(samples), checksum);
+    }
+
+    void RunBulkLoad(vector<BenchmarkResult>& results) const {
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            SearchServer search_server(corpus_.dictionary[0]);
+            out.push_back(MeasureNs([&] {
+                LoadServer(search_server, corpus_.documents);
+            }));
+            checksum = search_server.GetDocumentCount();
+        });
+        AddResult(results, "bulk_load"s, "seq"s, 0, corpus_.documents.size(), move(samples), checksum);
+    }
+
+    // Load and teardown of a whole server with and without the per-server pools.
+    // The checksum is the number of blocks taken from the heap after loading.
+    void RunAllocation(bool pooled, string policy_name, vector<BenchmarkResult>& results) const {
+        SearchServerOptions options;
+        options.pooled_allocation = pooled;
+        double checksum = 0;
+        size_t memory_bytes = 0;
+        vector<double> teardown_samples;
+        auto load_samples = CollectSamples(config_, [&](vector<double>& out) {
+            auto search_server = make_unique<SearchServer>(corpus_.dictionary[0], options);
+            out.push_back(MeasureNs([&] {
+                LoadServer(*search_server, corpus_.documents);
+            }));
+            const MemoryStats stats = search_server->GetMemoryStats();
+            checksum = stats.heap_allocations;
+            memory_bytes = stats.GetTotalBytes();
+            teardown_samples.push_back(MeasureNs([&] {
+                search_server.reset();
+            }));
+        });
+        teardown_samples.erase(teardown_samples.begin(), teardown_samples.begin() + config_.warmup);
+        AddResult(results, "allocation_load"s, policy_name, 0, corpus_.documents.size(),
+            move(load_samples), checksum, memory_bytes);
+        AddResult(results, "allocation_teardown"s, move(policy_name), 0, corpus_.documents.size(),
+            move(teardown_samples), checksum, memory_bytes);
+    }
+
+    // Loading with every document appended to a mutation log in a temporary file.
+    // The checksum is the number of fsync calls.
+    void RunIngest(const optional<MutationLogOptions>& log_options, string policy_name, vector<BenchmarkResult>& results) const {
+        const string path = (filesystem::temp_directory_path() / "search_server_benchmark.log"s).string();
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            filesystem::remove(path);
+            SearchServer search_server(corpus_.dictionary[0]);
+            unique_ptr<MutationLog> mutation_log;
+            if (log_options) {
+                mutation_log = make_unique<MutationLog>(path, *log_options);
+                search_server.SetMutationLog(mutation_log.get());
+            }
+            out.push_back(MeasureNs([&] {
+                LoadServer(search_server, corpus_.documents);
+                if (mutation_log) {
+                    mutation_log->Sync();
+                }
+            }));
+            checksum = mutation_log ? mutation_log->GetCommitCount() : 0;
+        });
+        filesystem::remove(path);
+        AddResult(results, "ingest"s, move(policy_name), 0, corpus_.documents.size(), move(samples), checksum);
+    }
+
+    template <typename ExecutionPolicy>
+    void RunRemoveDocument(const ExecutionPolicy& policy, string policy_name, vector<BenchmarkResult>& results) const {
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            SearchServer search_server(corpus_.dictionary[0]);
+            LoadServer(search_server, corpus_.documents);
+            for (size_t i = 0; i < corpus_.documents.size(); ++i) {
+                out.push_back(MeasureNs([&] {
+                    search_server.RemoveDocument(policy, static_cast<int>(i));
+                }));
+            }
+            checksum = search_server.GetDocumentCount();
+        });
+        AddResult(results, "remove_document"s, move(policy_name), 0, 1, move(samples), checksum);
+    }
+
+    // Every document removed from a server where one word is in all of them, so its
+    // posting list is as long as the corpus. Each erase shifts the postings after the
+    // removed id: removing lowest ids first is quadratic in the document frequency,
+    // highest first is linear.
+    void RunRemoveCommonWord(bool lowest_first, string policy_name, vector<BenchmarkResult>& results) const {
+        const string& common_word = corpus_.dictionary[1];
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            SearchServer search_server(corpus_.dictionary[0]);
+            for (size_t i = 0; i < corpus_.documents.size(); ++i) {
+                search_server.AddDocument(static_cast<int>(i), common_word + " "s + corpus_.documents[i],
+                    DocumentStatus::ACTUAL, { 1, 2, 3 });
+            }
+            out.push_back(MeasureNs([&] {
+                for (size_t i = 0; i < corpus_.documents.size(); ++i) {
+                    const size_t document_id = lowest_first ? i : corpus_.documents.size() - 1 - i;
+                    search_server.RemoveDocument(static_cast<int>(document_id));
+                }
+            }));
+            checksum = search_server.GetDocumentCount();
+        });
+        AddResult(results, "remove_common_word"s, move(policy_name), 0, corpus_.documents.size(), move(samples), checksum);
+    }
+
+    // Every document edited once: its last word replaced (remove_add and update_text)
+    // or its status and rating changed (update_metadata). The checksum is the
+    // number of postings afterwards.
+    void RunUpdateDocument(string policy_name, vector<BenchmarkResult>& results) const {
+        vector<string> edited_documents;
+        edited_documents.reserve(corpus_.documents.size());
+        for (size_t i = 0; i < corpus_.documents.size(); ++i) {
+            const string& document = corpus_.documents[i];
+            edited_documents.push_back(document.substr(0, document.rfind(' ') + 1)
+                + corpus_.dictionary[1 + i % (corpus_.dictionary.size() - 1)]);
+        }
+
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            SearchServer search_server(corpus_.dictionary[0]);
+            LoadServer(search_server, corpus_.documents);
+            for (size_t i = 0; i < corpus_.documents.size(); ++i) {
+                const int document_id = static_cast<int>(i);
+                out.push_back(MeasureNs([&] {
+                    if (policy_name == "remove_add"s) {
+                        search_server.RemoveDocument(document_id);
+                        search_server.AddDocument(document_id, edited_documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                    }
+                    else if (policy_name == "update_text"s) {
+                        search_server.UpdateDocument(document_id, edited_documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                    }
+                    else {
+                        search_server.UpdateDocument(document_id, corpus_.documents[i], DocumentStatus::BANNED, { 4, 5 });
+                    }
+                }));
+            }
+            checksum = search_server.GetMemoryStats().inverted_index.objects;
+        });
+        AddResult(results, "update_document"s, move(policy_name), 0, 1, move(samples), checksum);
+    }
+
+    void RunRemoveDuplicates(vector<BenchmarkResult>& results) const {
+        const size_t duplicates = static_cast<size_t>(corpus_.documents.size() * config_.duplicate_ratio);
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            SearchServer search_server(corpus_.dictionary[0]);
+            LoadServer(search_server, corpus_.documents);
+            for (size_t i = 0; i < duplicates; ++i) {
+                search_server.AddDocument(static_cast<int>(corpus_.documents.size() + i), corpus_.documents[i],
+                    DocumentStatus::ACTUAL, { 1, 2, 3 });
+            }
+            MuteStdout mute;
+            out.push_back(MeasureNs([&] {
+                RemoveDuplicates(search_server);
+            }));
+            checksum = search_server.GetDocumentCount();
+        });
+        AddResult(results, "remove_duplicates"s, "seq"s, 0, corpus_.documents.size() + duplicates, move(samples), checksum);
+    }
+
+    template <typename ExecutionPolicy>
+    void RunFindTopDocuments(const SearchServer& search_server, const vector<string>& queries, double minus_ratio,
+        const ExecutionPolicy& policy, string policy_name, vector<BenchmarkResult>& results) const {
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            checksum = 0;
+            for (const string& query : queries) {
+                vector<Document> documents;
+                out.push_back(MeasureNs([&] {
+                    documents = search_server.FindTopDocuments(policy, query);
+                }));
+                for (const Document& document : documents) {
+                    checksum += document.relevance;
+                }
+            }
+        });
+        AddResult(results, "find_top_documents"s, move(policy_name), minus_ratio, 1, move(samples), checksum);
+    }
+
+    // Sequential search through a reused QueryContext and result buffer.
+    void RunFindTopDocumentsWithContext(const SearchServer& search_server, const vector<string>& queries,
+        double minus_ratio, vector<BenchmarkResult>& results) const {
+        SearchServer::QueryContext context;
+        vector<Document> documents;
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            checksum = 0;
+            for (const string& query : queries) {
+                out.push_back(MeasureNs([&] {
+                    search_server.FindTopDocuments(query, context, documents);
+                }));
+                for (const Document& document : documents) {
+                    checksum += document.relevance;
+                }
+            }
+        });
+        AddResult(results, "find_top_documents"s, "context"s, minus_ratio, 1, move(samples), checksum);
+    }
+
+    template <typename ExecutionPolicy>
+    void RunMatchDocument(const SearchServer& search_server, const vector<string>& queries, double minus_ratio,
+        const ExecutionPolicy& policy, string policy_name, vector<BenchmarkResult>& results) const {
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            checksum = 0;
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const int document_id = static_cast<int>(i * corpus_.documents.size() / queries.size());
+                size_t matched = 0;
+                out.push_back(MeasureNs([&] {
+                    matched = get<0>(search_server.MatchDocument(policy, queries[i], document_id)).size();
+                }));
+                checksum += matched;
+            }
+        });
+        AddResult(results, "match_document"s, move(policy_name), minus_ratio, 1, move(samples), checksum);
+    }
+
+    // Every query timed on its own through the sequential FindTopDocuments; the
+    // checksum counts the results of the last repetition.
+    void RunQueries(const SearchServer& search_server, const vector<string>& queries, string name, string policy_name,
+        vector<BenchmarkResult>& results, size_t memory_bytes = 0) const {
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            checksum = 0;
+            for (const string& query : queries) {
+                vector<Document> documents;
+                out.push_back(MeasureNs([&] {
+                    documents = search_server.FindTopDocuments(query);
+                }));
+                checksum += documents.size();
+            }
+        });
+        AddResult(results, move(name), move(policy_name), 0, 1, move(samples), checksum, memory_bytes);
+    }
+
+    // Phrases checked by re-tokenizing candidates ("rescan") against the positional index ("index").
+    void RunPhraseSearch(const SearchServer& rescan_server, vector<BenchmarkResult>& results) const {
+        SearchServerOptions options;
+        options.positional_index = true;
+        SearchServer index_server(corpus_.dictionary[0], options);
+        LoadServer(index_server, corpus_.documents);
+        mt19937 generator(config_.seed + 2);
+        const auto queries = GeneratePhraseQueries(generator, corpus_.documents, config_.query_count, config_.phrase_length);
+
+        size_t text_bytes = 0;
+        for (const string& document : corpus_.documents) {
+            text_bytes += document.size();
+        }
+
+        RunQueries(rescan_server, queries, "phrase_search"s, "rescan"s, results, text_bytes);
+        RunQueries(index_server, queries, "phrase_search"s, "index"s, results, index_server.GetPositionalIndexSize());
+    }
+
+    // Queries with one substituted character in every word, against the exact index
+    // ("exact") and the one with typo expansion ("typo"); the checksum counts results.
+    void RunTypoSearch(const SearchServer& exact_server, vector<BenchmarkResult>& results) const {
+        SearchServerOptions options;
+        options.max_typo_distance = 2;
+        SearchServer typo_server(corpus_.dictionary[0], options);
+        LoadServer(typo_server, corpus_.documents);
+
+        mt19937 generator(config_.seed + 3);
+        const ZipfDistribution distribution(corpus_.dictionary.size(), zipf_exponent_);
+        auto queries = GenerateZipfQueries(generator, corpus_.dictionary, distribution,
+            config_.query_count, config_.words_per_query);
+        for (string& query : queries) {
+            for (size_t start = 0; start < query.size();) {
+                const size_t end = min(query.find(' ', start), query.size());
+                if (end > start) {
+                    query[start + generator() % (end - start)] = static_cast<char>('a' + generator() % 26);
+                }
+                start = end + 1;
+            }
+        }
+
+        RunQueries(exact_server, queries, "typo_search"s, "exact"s, results);
+        RunQueries(typo_server, queries, "typo_search"s, "typo"s, results);
+    }
+
+    void RunScoring(const SearchServer& tf_idf_server, vector<BenchmarkResult>& results) const {
+        SearchServerOptions options;
+        options.scoring = Scoring::BM25;
+        SearchServer bm25_server(corpus_.dictionary[0], options);
+        LoadServer(bm25_server, corpus_.documents);
+
+        mt19937 generator(config_.seed + 4);
+        const ZipfDistribution distribution(corpus_.dictionary.size(), zipf_exponent_);
+        const auto queries = GenerateZipfQueries(generator, corpus_.dictionary, distribution,
+            config_.query_count, config_.words_per_query);
+
+        RunQueries(tf_idf_server, queries, "scoring"s, "tf_idf"s, results);
+        RunQueries(bm25_server, queries, "scoring"s, "bm25"s, results);
+    }
+
+    // The same multi-word queries under OR and under AND semantics; AND scores only
+    // the intersection of the posting lists.
+    void RunConjunctive(const SearchServer& disjunctive_server, vector<BenchmarkResult>& results) const {
+        SearchServerOptions options;
+        options.conjunctive_queries = true;
+        SearchServer conjunctive_server(corpus_.dictionary[0], options);
+        LoadServer(conjunctive_server, corpus_.documents);
+
+        mt19937 generator(config_.seed + 5);
+        const ZipfDistribution distribution(corpus_.dictionary.size(), zipf_exponent_);
+        const auto queries = GenerateZipfQueries(generator, corpus_.dictionary, distribution,
+            config_.query_count, max(2, config_.words_per_query));
+
+        RunQueries(disjunctive_server, queries, "conjunctive"s, "or"s, results);
+        RunQueries(conjunctive_server, queries, "conjunctive"s, "and"s, results);
+    }
+
+    void RunProcessQueries(const SearchServer& search_server, const vector<string>& queries, double minus_ratio,
+        vector<BenchmarkResult>& results) const {
+        double checksum = 0;
+        auto samples = CollectSamples(config_, [&](vector<double>& out) {
+            size_t found = 0;
+            out.push_back(MeasureNs([&] {
+                for (const auto& documents : ProcessQueries(search_server, queries)) {
+                    found += documents.size();
+                }
+            }));
+            checksum = found;
+        });
+        AddResult(results, "process_queries"s, "par"s, minus_ratio, queries.size(), move(samples), checksum);
+
+        samples = CollectSamples(config_, [&](vector<double>& out) {
+            size_t found = 0;
+            out.push_back(MeasureNs([&] {
+                found = ProcessQueriesJoined(search_server, queries).size();
+            }));
+            checksum = found;
+        });
+        AddResult(results, "process_queries_joined"s, "par"s, minus_ratio, queries.size(), move(samples), checksum);
+    }
+};
+
+string FormatNumber(double value) {
+    if (!isfinite(value)) {
+        return "null"s;
+    }
+    ostringstream out;
+    out.precision(12);
+    out << value;
+    return out.str();
+}
+
+template <typename Container>
+void PrintJsonArray(ostream& out, const Container& values) {
+    out << '[';
+    bool first = true;
+    for (const auto value : values) {
+        if (!first) {
+            out << ", "s;
+        }
+        first = false;
+        out << FormatNumber(value);
+    }
+    out << ']';
+}
+
+}  // namespace
+
+BenchmarkConfig BenchmarkConfig::Quick() {
+    BenchmarkConfig config;
+    config.document_counts = { 1'000 };
+    config.zipf_exponents = { 1.0 };
+    config.minus_ratios = { 0.0, 0.2 };
+    config.query_count = 50;
+    config.repetitions = 2;
+    return config;
+}
+
+BenchmarkStats ComputeBenchmarkStats(vector<double> samples_ns, size_t batch_size) {
+    BenchmarkStats stats;
+    if (samples_ns.empty()) {
+        return stats;
+    }
+    sort(samples_ns.begin(), samples_ns.end());
+    const auto percentile = [&samples_ns](double p) {
+        const size_t rank = static_cast<size_t>(ceil(p * samples_ns.size()));
+        return samples_ns[rank == 0 ? 0 : rank - 1];
+    };
+    stats.samples = samples_ns.size();
+    stats.min_ns = samples_ns.front();
+    stats.max_ns = samples_ns.back();
+    stats.mean_ns = accumulate(samples_ns.begin(), samples_ns.end(), 0.0) / samples_ns.size();
+    stats.p50_ns = percentile(0.50);
+    stats.p90_ns = percentile(0.90);
+    stats.p99_ns = percentile(0.99);
+    stats.p999_ns = percentile(0.999);
+    stats.ops_per_second = stats.mean_ns > 0 ? batch_size * 1e9 / stats.mean_ns : 0;
+    return stats;
+}
+
+vector<BenchmarkResult> RunBenchmarks(const BenchmarkConfig& config) {
+    vector<BenchmarkResult> results;
+    mt19937 generator(config.seed);
+    const auto dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+    for (const double zipf_exponent : config.zipf_exponents) {
+        const ZipfDistribution distribution(dictionary.size(), zipf_exponent);
+        for (const int document_count : config.document_counts) {
+            const Corpus corpus{ dictionary,
+                GenerateZipfQueries(generator, dictionary, distribution, document_count, config.words_per_document) };
+            BenchmarkRunner(config, corpus, document_count, zipf_exponent).Run(results);
+        }
+    }
+    return results;
+}
+
+void PrintBenchmarksJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkResult>& results) {
+    out << "{\n"s;
+    out << "  \"config\": {\n"s;
+    out << "    \"document_counts\": "s;
+    PrintJsonArray(out, config.document_counts);
+    out << ",\n    \"zipf_exponents\": "s;
+    PrintJsonArray(out, config.zipf_exponents);
+    out << ",\n    \"minus_ratios\": "s;
+    PrintJsonArray(out, config.minus_ratios);
+    out << ",\n    \"dictionary_size\": "s << config.dictionary_size
+        << ",\n    \"max_word_length\": "s << config.max_word_length
+        << ",\n    \"words_per_document\": "s << config.words_per_document
+        << ",\n    \"words_per_query\": "s << config.words_per_query
+        << ",\n    \"query_count\": "s << config.query_count
+        << ",\n    \"phrase_length\": "s << config.phrase_length
+        << ",\n    \"duplicate_ratio\": "s << FormatNumber(config.duplicate_ratio)
+        << ",\n    \"warmup\": "s << config.warmup
+        << ",\n    \"repetitions\": "s << config.repetitions
+        << ",\n    \"seed\": "s << config.seed
+        << "\n  },\n"s;
+    out << "  \"results\": ["s;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        out << (i == 0 ? "\n"s : ",\n"s);
+        out << "    { \"name\": \""s << result.name << "\""s
+            << ", \"policy\": \""s << result.policy << "\""s
+            << ", \"document_count\": "s << result.document_count
+            << ", \"zipf_exponent\": "s << FormatNumber(result.zipf_exponent)
+            << ", \"minus_ratio\": "s << FormatNumber(result.minus_ratio)
+            << ", \"batch_size\": "s << result.batch_size
+            << ", \"samples\": "s << result.stats.samples
+            << ", \"min_ns\": "s << FormatNumber(result.stats.min_ns)
+            << ", \"mean_ns\": "s << FormatNumber(result.stats.mean_ns)
+            << ", \"p50_ns\": "s << FormatNumber(result.stats.p50_ns)
+            << ", \"p90_ns\": "s << FormatNumber(result.stats.p90_ns)
+            << ", \"p99_ns\": "s << FormatNumber(result.stats.p99_ns)
+            << ", \"p999_ns\": "s << FormatNumber(result.stats.p999_ns)
+            << ", \"max_ns\": "s << FormatNumber(result.stats.max_ns)
+            << ", \"ops_per_second\": "s << FormatNumber(result.stats.ops_per_second)
+            << ", \"checksum\": "s << FormatNumber(result.checksum)
+            << ", \"memory_bytes\": "s << result.memory_bytes << " }"s;
+    }
+    out << "\n  ]\n}\n"s;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct BenchmarkConfig {
+    vector<int> document_counts = { 1'000, 10'000 };
+    vector<double> zipf_exponents = { 0.0, 1.0 };
+    vector<double> minus_ratios = { 0.0, 0.2 };
+    int dictionary_size = 1'000;
+    int max_word_length = 10;
+    int words_per_document = 70;
+    int words_per_query = 10;
+    int query_count = 100;
+    int phrase_length = 3;
+    double duplicate_ratio = 0.1;
+    int warmup = 1;
+    int repetitions = 5;
+    unsigned seed = 5489u;
+
+    static BenchmarkConfig Quick();
+};
+
+struct BenchmarkStats {
+    size_t samples = 0;
+    double min_ns = 0;
+    double mean_ns = 0;
+    double p50_ns = 0;
+    double p90_ns = 0;
+    double p99_ns = 0;
+    double p999_ns = 0;
+    double max_ns = 0;
+    double ops_per_second = 0;
+};
+
+struct BenchmarkResult {
+    string name;
+    string policy;
+    int document_count = 0;
+    double zipf_exponent = 0;
+    double minus_ratio = 0;
+    // Operations per sample: a bulk load or a query batch is timed as one sample.
+    size_t batch_size = 1;
+    BenchmarkStats stats;
+    // Derived from the results, so that runs can be compared for correctness too.
+    double checksum = 0;
+    // Size of the index structure the case exercises, when it has one.
+    size_t memory_bytes = 0;
+};
+
+BenchmarkStats ComputeBenchmarkStats(vector<double> samples_ns, size_t batch_size);
+
+vector<BenchmarkResult> RunBenchmarks(const BenchmarkConfig& config);
+
+void PrintBenchmarksJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkResult>& results);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Number of documents containing each word, plus the total number of documents
+// and their total length in non-stop words. Several SearchServer instances can
+// share one object so that their IDF values and the BM25 average document length
+// are computed over the whole collection rather than over their own part of it.
+// Thread-safe: shards update it concurrently while the others read it.
+class DocumentFrequencies {
+public:
+    template <typename WordFrequencies>
+    void AddDocument(const WordFrequencies& words, size_t length) {
+        lock_guard lock(mutex_);
+        for (const auto& [word, _] : words) {
+            const auto it = document_freqs_.find(word);
+            if (it == document_freqs_.end()) {
+                document_freqs_.emplace(string(word), 1);
+            }
+            else {
+                ++it->second;
+            }
+        }
+        ++document_count_;
+        total_document_length_ += length;
+    }
+
+    template <typename WordFrequencies>
+    void RemoveDocument(const WordFrequencies& words, size_t length) {
+        lock_guard lock(mutex_);
+        for (const auto& [word, _] : words) {
+            const auto it = document_freqs_.find(word);
+            if (it != document_freqs_.end() && --it->second == 0) {
+                document_freqs_.erase(it);
+            }
+        }
+        --document_count_;
+        total_document_length_ -= length;
+    }
+
+    int GetDocumentCount() const {
+        shared_lock lock(mutex_);
+        return document_count_;
+    }
+
+    double GetAverageDocumentLength() const {
+        shared_lock lock(mutex_);
+        return document_count_ == 0 ? 0 : total_document_length_ * 1.0 / document_count_;
+    }
+
+    size_t GetDocumentFreq(string_view word) const {
+        shared_lock lock(mutex_);
+        const auto it = document_freqs_.find(word);
+        return it == document_freqs_.end() ? 0 : it->second;
+    }
+
+private:
+    mutable shared_mutex mutex_;
+    map<string, size_t, less<>> document_freqs_;
+    int document_count_ = 0;
+    size_t total_document_length_ = 0;
+};
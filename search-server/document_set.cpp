@@ -0,0 +1,215 @@
+#include "document_set.h"
+
+#include <algorithm>
+
+DocumentSet::DocumentSet(const allocator_type& allocator)
+    : chunks_(allocator) {
+}
+
+DocumentSet::DocumentSet(const DocumentSet& other, const allocator_type& allocator)
+    : chunks_(allocator)
+    , size_(other.size_) {
+    chunks_.reserve(other.chunks_.size());
+    for (const Chunk& chunk : other.chunks_) {
+        chunks_.emplace_back(chunk, allocator.resource());
+    }
+}
+
+DocumentSet::DocumentSet(DocumentSet&& other, const allocator_type& allocator)
+    : chunks_(move(other.chunks_), allocator)
+    , size_(other.size_) {
+}
+
+void DocumentSet::Add(int document_id) {
+    const auto [key, value] = Split(document_id);
+    auto it = FindChunk(key);
+    if (it == chunks_.end() || it->key != key) {
+        it = chunks_.insert(it, Chunk(key, chunks_.get_allocator().resource()));
+    }
+    const uint32_t before = it->cardinality;
+    it->Add(value);
+    size_ += it->cardinality - before;
+}
+
+void DocumentSet::Remove(int document_id) {
+    const auto [key, value] = Split(document_id);
+    const auto it = FindChunk(key);
+    if (it == chunks_.end() || it->key != key) {
+        return;
+    }
+    const uint32_t before = it->cardinality;
+    it->Remove(value);
+    size_ -= before - it->cardinality;
+    if (it->cardinality == 0) {
+        chunks_.erase(it);
+    }
+}
+
+bool DocumentSet::Contains(int document_id) const {
+    const auto [key, value] = Split(document_id);
+    const auto it = FindChunk(key);
+    return it != chunks_.end() && it->key == key && it->Contains(value);
+}
+
+void DocumentSet::UnionWith(const DocumentSet& other) {
+    pmr::memory_resource* resource = chunks_.get_allocator().resource();
+    pmr::vector<Chunk> merged(resource);
+    merged.reserve(chunks_.size() + other.chunks_.size());
+    auto lhs = chunks_.begin();
+    auto rhs = other.chunks_.begin();
+    while (lhs != chunks_.end() || rhs != other.chunks_.end()) {
+        if (rhs == other.chunks_.end() || (lhs != chunks_.end() && lhs->key < rhs->key)) {
+            merged.push_back(move(*lhs++));
+        }
+        else if (lhs == chunks_.end() || rhs->key < lhs->key) {
+            merged.emplace_back(*rhs++, resource);
+        }
+        else {
+            lhs->UnionWith(*rhs++);
+            merged.push_back(move(*lhs++));
+        }
+    }
+    chunks_ = move(merged);
+    size_ = 0;
+    for (const Chunk& chunk : chunks_) {
+        size_ += chunk.cardinality;
+    }
+}
+
+void DocumentSet::Clear() {
+    chunks_.clear();
+    size_ = 0;
+}
+
+size_t DocumentSet::GetSize() const {
+    return size_;
+}
+
+bool DocumentSet::IsEmpty() const {
+    return size_ == 0;
+}
+
+pair<uint16_t, uint16_t> DocumentSet::Split(int document_id) {
+    const auto id = static_cast<uint32_t>(document_id);
+    return { static_cast<uint16_t>(id >> 16), static_cast<uint16_t>(id & 0xFFFF) };
+}
+
+pmr::vector<DocumentSet::Chunk>::iterator DocumentSet::FindChunk(uint16_t key) {
+    return lower_bound(chunks_.begin(), chunks_.end(), key,
+        [](const Chunk& chunk, uint16_t value) { return chunk.key < value; });
+}
+
+pmr::vector<DocumentSet::Chunk>::const_iterator DocumentSet::FindChunk(uint16_t key) const {
+    return lower_bound(chunks_.begin(), chunks_.end(), key,
+        [](const Chunk& chunk, uint16_t value) { return chunk.key < value; });
+}
+
+DocumentSet::Chunk::Chunk(uint16_t key, pmr::memory_resource* resource)
+    : key(key)
+    , array(resource)
+    , bitmap(resource) {
+}
+
+DocumentSet::Chunk::Chunk(const Chunk& other, pmr::memory_resource* resource)
+    : key(other.key)
+    , cardinality(other.cardinality)
+    , array(other.array, resource)
+    , bitmap(other.bitmap, resource) {
+}
+
+bool DocumentSet::Chunk::Contains(uint16_t value) const {
+    if (IsBitmap()) {
+        return (bitmap[value >> 6] >> (value & 63)) & 1;
+    }
+    return binary_search(array.begin(), array.end(), value);
+}
+
+void DocumentSet::Chunk::Add(uint16_t value) {
+    if (IsBitmap()) {
+        uint64_t& word = bitmap[value >> 6];
+        const uint64_t bit = 1ULL << (value & 63);
+        cardinality += (word & bit) == 0;
+        word |= bit;
+        return;
+    }
+    const auto it = lower_bound(array.begin(), array.end(), value);
+    if (it != array.end() && *it == value) {
+        return;
+    }
+    array.insert(it, value);
+    ++cardinality;
+    if (cardinality > ARRAY_LIMIT) {
+        ToBitmap();
+    }
+}
+
+void DocumentSet::Chunk::Remove(uint16_t value) {
+    if (IsBitmap()) {
+        uint64_t& word = bitmap[value >> 6];
+        const uint64_t bit = 1ULL << (value & 63);
+        cardinality -= (word & bit) != 0;
+        word &= ~bit;
+        if (cardinality <= ARRAY_LIMIT / 2) {
+            ToArray();
+        }
+        return;
+    }
+    const auto it = lower_bound(array.begin(), array.end(), value);
+    if (it != array.end() && *it == value) {
+        array.erase(it);
+        --cardinality;
+    }
+}
+
+void DocumentSet::Chunk::UnionWith(const Chunk& other) {
+    if (!IsBitmap() && !other.IsBitmap() && cardinality + other.cardinality <= ARRAY_LIMIT) {
+        pmr::vector<uint16_t> merged(array.get_allocator());
+        merged.reserve(array.size() + other.array.size());
+        set_union(array.begin(), array.end(), other.array.begin(), other.array.end(), back_inserter(merged));
+        array = move(merged);
+        cardinality = static_cast<uint32_t>(array.size());
+        return;
+    }
+    ToBitmap();
+    if (other.IsBitmap()) {
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            bitmap[i] |= other.bitmap[i];
+        }
+    }
+    else {
+        for (const uint16_t value : other.array) {
+            bitmap[value >> 6] |= 1ULL << (value & 63);
+        }
+    }
+    cardinality = 0;
+    for (const uint64_t word : bitmap) {
+        cardinality += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+}
+
+void DocumentSet::Chunk::ToBitmap() {
+    if (IsBitmap()) {
+        return;
+    }
+    bitmap.assign(BITMAP_WORDS, 0);
+    for (const uint16_t value : array) {
+        bitmap[value >> 6] |= 1ULL << (value & 63);
+    }
+    array.clear();
+    array.shrink_to_fit();
+}
+
+void DocumentSet::Chunk::ToArray() {
+    if (!IsBitmap()) {
+        return;
+    }
+    array.clear();
+    array.reserve(cardinality);
+    for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+        for (uint64_t word = bitmap[i]; word != 0; word &= word - 1) {
+            array.push_back(static_cast<uint16_t>(i * 64 + __builtin_ctzll(word)));
+        }
+    }
+    bitmap.clear();
+    bitmap.shrink_to_fit();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Compressed set of document ids in the spirit of Roaring bitmaps. Ids are split
+// by their upper 16 bits into chunks; a chunk with few ids stores them as a sorted
+// array of the lower 16 bits, a dense chunk switches to a 65536-bit bitmap.
+class DocumentSet {
+public:
+    using allocator_type = pmr::polymorphic_allocator<byte>;
+
+    DocumentSet() = default;
+    explicit DocumentSet(const allocator_type& allocator);
+    DocumentSet(const DocumentSet& other, const allocator_type& allocator);
+    DocumentSet(DocumentSet&& other, const allocator_type& allocator);
+
+    void Add(int document_id);
+    void Remove(int document_id);
+    bool Contains(int document_id) const;
+    void UnionWith(const DocumentSet& other);
+    void Clear();
+
+    size_t GetSize() const;
+    bool IsEmpty() const;
+
+private:
+    static constexpr size_t ARRAY_LIMIT = 4096;
+    static constexpr size_t BITMAP_WORDS = 65536 / 64;
+
+    struct Chunk {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        // Exactly one of them is in use: bitmap when non-empty.
+        pmr::vector<uint16_t> array;
+        pmr::vector<uint64_t> bitmap;
+
+        Chunk(uint16_t key, pmr::memory_resource* resource);
+        Chunk(const Chunk& other, pmr::memory_resource* resource);
+
+        bool IsBitmap() const {
+            return !bitmap.empty();
+        }
+
+        bool Contains(uint16_t value) const;
+        void Add(uint16_t value);
+        void Remove(uint16_t value);
+        void UnionWith(const Chunk& other);
+        void ToBitmap();
+        void ToArray();
+    };
+
+    pmr::vector<Chunk> chunks_;
+    size_t size_ = 0;
+
+    static pair<uint16_t, uint16_t> Split(int document_id);
+    pmr::vector<Chunk>::iterator FindChunk(uint16_t key);
+    pmr::vector<Chunk>::const_iterator FindChunk(uint16_t key) const;
+};
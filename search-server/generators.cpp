@@ -0,0 +1,115 @@
+#include "generators.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "string_processing.h"
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution((int)'a', (int)'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+ZipfDistribution::ZipfDistribution(size_t n, double exponent)
+    : cdf_(n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += 1.0 / pow(static_cast<double>(i + 1), exponent);
+        cdf_[i] = sum;
+    }
+    for (double& value : cdf_) {
+        value /= sum;
+    }
+}
+
+size_t ZipfDistribution::operator()(mt19937& generator) const {
+    const double value = uniform_real_distribution<>(0, 1)(generator);
+    const auto it = lower_bound(cdf_.begin(), cdf_.end(), value);
+    return min(static_cast<size_t>(it - cdf_.begin()), cdf_.size() - 1);
+}
+
+string GenerateZipfQuery(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& distribution,
+    int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[distribution(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateZipfQueries(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& distribution,
+    int query_count, int max_word_count, double minus_prob) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateZipfQuery(generator, dictionary, distribution, max_word_count, minus_prob));
+    }
+    return queries;
+}
+
+vector<string> GeneratePhraseQueries(mt19937& generator, const vector<string>& documents, int query_count, int phrase_length) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    while (static_cast<int>(queries.size()) < query_count) {
+        const string& document = documents[uniform_int_distribution<size_t>(0, documents.size() - 1)(generator)];
+        const vector<string_view> words = SplitIntoWords(document);
+        if (static_cast<int>(words.size()) < phrase_length) {
+            continue;
+        }
+        const size_t start = uniform_int_distribution<size_t>(0, words.size() - phrase_length)(generator);
+        string query = "\""s;
+        for (int i = 0; i < phrase_length; ++i) {
+            if (i > 0) {
+                query.push_back(' ');
+            }
+            query += words[start + i];
+        }
+        query.push_back('"');
+        queries.push_back(move(query));
+    }
+    return queries;
+}
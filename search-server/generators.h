@@ -0,0 +1,32 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+string GenerateWord(mt19937& generator, int max_length);
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length);
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0);
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count);
+
+// Picks rank i of n with probability proportional to 1 / (i + 1)^exponent.
+// Exponent 0 gives the uniform distribution.
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t n, double exponent);
+
+    size_t operator()(mt19937& generator) const;
+
+private:
+    vector<double> cdf_;
+};
+
+string GenerateZipfQuery(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& distribution,
+    int word_count, double minus_prob = 0);
+vector<string> GenerateZipfQueries(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& distribution,
+    int query_count, int max_word_count, double minus_prob = 0);
+
+// Quoted phrases of phrase_length consecutive words taken from random documents.
+vector<string> GeneratePhraseQueries(mt19937& generator, const vector<string>& documents, int query_count, int phrase_length);
@@ -0,0 +1,176 @@
+#include "mapped_corpus.h"
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <execution>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "search_server.h"
+
+namespace {
+
+DocumentStatus ParseStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("Unknown document status "s + string(text));
+}
+
+string_view NextField(string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == line.npos) {
+        throw invalid_argument("Corpus line has too few fields"s);
+    }
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        throw invalid_argument("Invalid number "s + string(text));
+    }
+    return value;
+}
+
+CorpusRecord ParseRecord(string_view line) {
+    CorpusRecord record;
+    record.id = ParseInt(NextField(line));
+    record.status = ParseStatus(NextField(line));
+    for (const string_view rating : SplitIntoWords(NextField(line))) {
+        if (!rating.empty()) {
+            record.ratings.push_back(ParseInt(rating));
+        }
+    }
+    if (record.ratings.empty()) {
+        throw invalid_argument("Document has no ratings"s);
+    }
+    record.text = line;
+    return record;
+}
+
+void ParseChunk(string_view data, size_t offset, vector<CorpusRecord>& records) {
+    while (!data.empty()) {
+        const size_t end = min(data.find('\n'), data.size());
+        string_view line = data.substr(0, end);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            try {
+                records.push_back(ParseRecord(line));
+            }
+            catch (const invalid_argument& error) {
+                throw invalid_argument("Corpus line at offset "s + to_string(offset) + ": "s + error.what());
+            }
+        }
+        offset += min(end + 1, data.size());
+        data.remove_prefix(min(end + 1, data.size()));
+    }
+}
+
+}  // namespace
+
+MappedFile::MappedFile(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Cannot open "s + path);
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw runtime_error("Cannot stat "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Cannot map "s + path);
+        }
+        madvise(mapping, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mapping);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+string_view MappedFile::GetData() const {
+    return { data_, size_ };
+}
+
+vector<CorpusRecord> ParseCorpus(string_view data, size_t chunk_count) {
+    chunk_count = max<size_t>(1, min(chunk_count, data.size() / 4096 + 1));
+
+    vector<size_t> bounds{ 0 };
+    for (size_t i = 1; i < chunk_count; ++i) {
+        size_t bound = max(bounds.back(), i * data.size() / chunk_count);
+        bound = data.find('\n', bound);
+        bounds.push_back(bound == data.npos ? data.size() : bound + 1);
+    }
+    bounds.push_back(data.size());
+
+    vector<vector<CorpusRecord>> chunks(chunk_count);
+    // Parallel algorithms terminate on escaping exceptions, so errors are carried out by hand.
+    vector<exception_ptr> errors(chunk_count);
+    vector<size_t> indexes(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        indexes[i] = i;
+    }
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        try {
+            ParseChunk(data.substr(bounds[i], bounds[i + 1] - bounds[i]), bounds[i], chunks[i]);
+        }
+        catch (...) {
+            errors[i] = current_exception();
+        }
+    });
+    for (const exception_ptr& error : errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        total += chunk.size();
+    }
+    vector<CorpusRecord> records;
+    records.reserve(total);
+    for (auto& chunk : chunks) {
+        move(chunk.begin(), chunk.end(), back_inserter(records));
+    }
+    return records;
+}
+
+size_t LoadCorpus(SearchServer& search_server, const string& path, size_t chunk_count) {
+    auto file = make_shared<const MappedFile>(path);
+    const auto records = ParseCorpus(file->GetData(), chunk_count);
+    search_server.KeepAlive(file);
+    for (const CorpusRecord& record : records) {
+        search_server.AddExternalDocument(record.id, record.text, record.status, record.ratings);
+    }
+    return records.size();
+}
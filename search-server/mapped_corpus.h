@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+using namespace std;
+
+class SearchServer;
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    explicit MappedFile(const string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    string_view GetData() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// One corpus line: "<id>\t<status>\t<ratings>\t<text>", where status is ACTUAL,
+// IRRELEVANT, BANNED or REMOVED and ratings are space-separated integers.
+// Empty lines are skipped.
+struct CorpusRecord {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    vector<int> ratings;
+    string_view text;
+};
+
+// Parses the data in chunk_count chunks split at line boundaries, in parallel.
+// Record texts point into data.
+vector<CorpusRecord> ParseCorpus(string_view data, size_t chunk_count = max(1u, thread::hardware_concurrency()));
+
+// Maps the file, parses it and adds every record to the server without copying
+// the document text. The server keeps the mapping alive. Returns the number of documents.
+size_t LoadCorpus(SearchServer& search_server, const string& path,
+    size_t chunk_count = max(1u, thread::hardware_concurrency()));
@@ -0,0 +1,98 @@
+#include "memory_stats.h"
+
+#include <string>
+#include <utility>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace std::literals;
+
+TrackingMemoryResource::TrackingMemoryResource(pmr::memory_resource* upstream)
+    : upstream_(upstream) {
+}
+
+size_t TrackingMemoryResource::GetBytes() const {
+    return bytes_.load(memory_order_relaxed);
+}
+
+size_t TrackingMemoryResource::GetFootprint() const {
+    return footprint_.load(memory_order_relaxed);
+}
+
+size_t TrackingMemoryResource::GetAllocationCount() const {
+    return allocations_.load(memory_order_relaxed);
+}
+
+void* TrackingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = upstream_->allocate(bytes, alignment);
+    bytes_.fetch_add(bytes, memory_order_relaxed);
+    footprint_.fetch_add(GetHeapFootprint(p, bytes), memory_order_relaxed);
+    allocations_.fetch_add(1, memory_order_relaxed);
+    return p;
+}
+
+void TrackingMemoryResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    bytes_.fetch_sub(bytes, memory_order_relaxed);
+    footprint_.fetch_sub(GetHeapFootprint(p, bytes), memory_order_relaxed);
+    allocations_.fetch_sub(1, memory_order_relaxed);
+    upstream_->deallocate(p, bytes, alignment);
+}
+
+bool TrackingMemoryResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+size_t TrackingMemoryResource::GetHeapFootprint([[maybe_unused]] void* p, size_t bytes) const {
+#ifdef __GLIBC__
+    // new_delete_resource ends up in malloc: the usable size plus the chunk header
+    // is what the block really takes from the heap.
+    if (upstream_ == pmr::new_delete_resource()) {
+        return malloc_usable_size(p) + sizeof(size_t);
+    }
+#endif
+    return bytes;
+}
+
+size_t MemoryStats::GetTotalBytes() const {
+    return document_text.bytes + inverted_index.bytes + forward_index.bytes
+        + documents.bytes + stop_words.bytes + positional_index.bytes + typo_index.bytes + allocator_overhead;
+}
+
+namespace {
+
+const pair<const char*, MemoryUsage MemoryStats::*> STRUCTURES[] = {
+    { "document_text", &MemoryStats::document_text },
+    { "inverted_index", &MemoryStats::inverted_index },
+    { "forward_index", &MemoryStats::forward_index },
+    { "documents", &MemoryStats::documents },
+    { "stop_words", &MemoryStats::stop_words },
+    { "positional_index", &MemoryStats::positional_index },
+    { "typo_index", &MemoryStats::typo_index },
+};
+
+} // namespace
+
+void MemoryStats::PrintText(ostream& out) const {
+    for (const auto& [name, usage] : STRUCTURES) {
+        out << name << ": bytes = "s << (this->*usage).bytes
+            << ", allocations = "s << (this->*usage).allocations
+            << ", objects = "s << (this->*usage).objects << '\n';
+    }
+    out << "allocator_overhead: "s << allocator_overhead << '\n';
+    out << "heap_allocations: "s << heap_allocations << '\n';
+    out << "total: "s << GetTotalBytes() << '\n';
+}
+
+void MemoryStats::PrintJson(ostream& out) const {
+    out << '{';
+    for (const auto& [name, usage] : STRUCTURES) {
+        out << '"' << name << "\": {\"bytes\": "s << (this->*usage).bytes
+            << ", \"allocations\": "s << (this->*usage).allocations
+            << ", \"objects\": "s << (this->*usage).objects << "}, "s;
+    }
+    out << "\"allocator_overhead\": "s << allocator_overhead
+        << ", \"heap_allocations\": "s << heap_allocations
+        << ", \"total_bytes\": "s << GetTotalBytes() << '}';
+}
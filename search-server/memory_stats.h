@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+
+using namespace std;
+
+// Memory resource that counts every allocation passing through it before
+// forwarding it upstream. Counters are atomic, so it may be shared by containers
+// modified from several threads as long as the upstream resource allows it.
+class TrackingMemoryResource : public pmr::memory_resource {
+public:
+    explicit TrackingMemoryResource(pmr::memory_resource* upstream = pmr::new_delete_resource());
+
+    // Bytes requested by the containers and not yet released.
+    size_t GetBytes() const;
+    // Bytes the heap actually holds for them, including its chunk headers and
+    // rounding. Equal to GetBytes() when the heap cannot report it.
+    size_t GetFootprint() const;
+    size_t GetAllocationCount() const;
+
+private:
+    pmr::memory_resource* upstream_;
+    atomic<size_t> bytes_ = 0;
+    atomic<size_t> footprint_ = 0;
+    atomic<size_t> allocations_ = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override;
+
+    size_t GetHeapFootprint(void* p, size_t bytes) const;
+};
+
+struct MemoryUsage {
+    size_t bytes = 0;
+    size_t allocations = 0;
+    size_t objects = 0;
+};
+
+// Live heap usage of a SearchServer, by structure. Objects are texts, postings,
+// documents, stop words, position lists and typo index terms respectively.
+struct MemoryStats {
+    MemoryUsage document_text;
+    MemoryUsage inverted_index;
+    MemoryUsage forward_index;
+    MemoryUsage documents;
+    MemoryUsage stop_words;
+    MemoryUsage positional_index;
+    MemoryUsage typo_index;
+    // Heap bookkeeping, rounding and unused pool space on top of the requested bytes.
+    size_t allocator_overhead = 0;
+    // Blocks taken from the heap. With pooled allocation far fewer than the
+    // containers' allocations, which the pools serve from shared blocks.
+    size_t heap_allocations = 0;
+
+    size_t GetTotalBytes() const;
+    void PrintText(ostream& out) const;
+    void PrintJson(ostream& out) const;
+};
@@ -0,0 +1,198 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std::literals;
+
+string_view GetTimerName(Timer timer) {
+    switch (timer) {
+    case Timer::FIND_TOP_DOCUMENTS:
+        return "find_top_documents"sv;
+    case Timer::ADD_DOCUMENT:
+        return "add_document"sv;
+    case Timer::REMOVE_DOCUMENT:
+        return "remove_document"sv;
+    case Timer::UPDATE_DOCUMENT:
+        return "update_document"sv;
+    case Timer::PROCESS_QUERIES:
+        return "process_queries"sv;
+    default:
+        return "unknown"sv;
+    }
+}
+
+string_view GetCounterName(Counter counter) {
+    switch (counter) {
+    case Counter::QUERIES:
+        return "queries"sv;
+    case Counter::POSTINGS_SCANNED:
+        return "postings_scanned"sv;
+    case Counter::DOCUMENTS_SCORED:
+        return "documents_scored"sv;
+    default:
+        return "unknown"sv;
+    }
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < 2 * SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    // The buckets end at 2^63: larger values go to the last one.
+    value = std::min(value, (uint64_t{ 1 } << 63) - 1);
+    int msb = 63;
+    while ((value >> msb) == 0) {
+        --msb;
+    }
+    const int shift = msb - SUB_BUCKET_BITS;
+    const uint64_t mantissa = value >> shift;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + static_cast<size_t>(mantissa - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::GetBucketLowerBound(size_t index) {
+    if (index < 2 * SUB_BUCKETS) {
+        return index;
+    }
+    const size_t shift = index / SUB_BUCKETS - 1;
+    const uint64_t mantissa = SUB_BUCKETS + index % SUB_BUCKETS;
+    return mantissa << shift;
+}
+
+void LatencyHistogram::MergeInto(vector<uint64_t>& buckets, uint64_t& sum, uint64_t& max) const {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i] += buckets_[i].load(memory_order_relaxed);
+    }
+    sum += sum_.load(memory_order_relaxed);
+    max = std::max(max, max_.load(memory_order_relaxed));
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, memory_order_relaxed);
+    }
+    sum_.store(0, memory_order_relaxed);
+    max_.store(0, memory_order_relaxed);
+}
+
+double HistogramSnapshot::Mean() const {
+    return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+uint64_t HistogramSnapshot::Percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(p * count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::GetBucketLowerBound(i), max);
+        }
+    }
+    return max;
+}
+
+void MetricsSnapshot::PrintText(ostream& out) const {
+    for (size_t i = 0; i < timers.size(); ++i) {
+        const HistogramSnapshot& timer = timers[i];
+        out << GetTimerName(static_cast<Timer>(i))
+            << ": count = "s << timer.count
+            << ", mean = "s << static_cast<uint64_t>(timer.Mean()) << " ns"s
+            << ", p50 = "s << timer.Percentile(0.5) << " ns"s
+            << ", p99 = "s << timer.Percentile(0.99) << " ns"s
+            << ", p999 = "s << timer.Percentile(0.999) << " ns"s
+            << ", max = "s << timer.max << " ns"s << '\n';
+    }
+    for (size_t i = 0; i < counters.size(); ++i) {
+        out << GetCounterName(static_cast<Counter>(i)) << ": "s << counters[i] << '\n';
+    }
+}
+
+void MetricsSnapshot::PrintJson(ostream& out) const {
+    out << "{\"timers\": {"s;
+    for (size_t i = 0; i < timers.size(); ++i) {
+        const HistogramSnapshot& timer = timers[i];
+        out << (i == 0 ? ""s : ", "s)
+            << '"' << GetTimerName(static_cast<Timer>(i)) << "\": {"s
+            << "\"count\": "s << timer.count
+            << ", \"sum_ns\": "s << timer.sum
+            << ", \"mean_ns\": "s << timer.Mean()
+            << ", \"p50_ns\": "s << timer.Percentile(0.5)
+            << ", \"p90_ns\": "s << timer.Percentile(0.9)
+            << ", \"p99_ns\": "s << timer.Percentile(0.99)
+            << ", \"p999_ns\": "s << timer.Percentile(0.999)
+            << ", \"max_ns\": "s << timer.max << '}';
+    }
+    out << "}, \"counters\": {"s;
+    for (size_t i = 0; i < counters.size(); ++i) {
+        out << (i == 0 ? ""s : ", "s)
+            << '"' << GetCounterName(static_cast<Counter>(i)) << "\": "s << counters[i];
+    }
+    out << "}}"s;
+}
+
+MetricsRegistry& MetricsRegistry::Instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsSnapshot MetricsRegistry::GetSnapshot() const {
+    MetricsSnapshot snapshot;
+    lock_guard guard(mutex_);
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < shard->timers.size(); ++i) {
+            HistogramSnapshot& timer = snapshot.timers[i];
+            shard->timers[i].MergeInto(timer.buckets, timer.sum, timer.max);
+        }
+        for (size_t i = 0; i < shard->counters.size(); ++i) {
+            snapshot.counters[i] += shard->counters[i].load(memory_order_relaxed);
+        }
+    }
+    for (HistogramSnapshot& timer : snapshot.timers) {
+        for (const uint64_t bucket : timer.buckets) {
+            timer.count += bucket;
+        }
+    }
+    return snapshot;
+}
+
+void MetricsRegistry::Reset() {
+    lock_guard guard(mutex_);
+    for (auto& shard : shards_) {
+        for (auto& timer : shard->timers) {
+            timer.Reset();
+        }
+        for (auto& counter : shard->counters) {
+            counter.store(0, memory_order_relaxed);
+        }
+    }
+}
+
+size_t MetricsRegistry::GetShardCount() const {
+    lock_guard guard(mutex_);
+    return shards_.size();
+}
+
+MetricsRegistry::Shard& MetricsRegistry::AcquireShard() {
+    lock_guard guard(mutex_);
+    if (!free_shards_.empty()) {
+        Shard* shard = free_shards_.back();
+        free_shards_.pop_back();
+        return *shard;
+    }
+    shards_.push_back(make_unique<Shard>());
+    return *shards_.back();
+}
+
+void MetricsRegistry::ReleaseShard(Shard& shard) {
+    lock_guard guard(mutex_);
+    free_shards_.push_back(&shard);
+}
+
+MetricsRegistry::ShardLease::~ShardLease() {
+    if (shard != nullptr) {
+        MetricsRegistry::Instance().ReleaseShard(*shard);
+    }
+}
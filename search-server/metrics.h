@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "log_duration.h"
+
+using namespace std;
+
+// Instrumentation hooks. Define SEARCH_SERVER_DISABLE_METRICS to compile them out:
+// the macros below then expand to nothing.
+
+enum class Timer {
+    FIND_TOP_DOCUMENTS,
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+    UPDATE_DOCUMENT,
+    PROCESS_QUERIES,
+    COUNT,
+};
+
+enum class Counter {
+    QUERIES,
+    POSTINGS_SCANNED,
+    DOCUMENTS_SCORED,
+    COUNT,
+};
+
+string_view GetTimerName(Timer timer);
+string_view GetCounterName(Counter counter);
+
+// Log-linear buckets in the spirit of HdrHistogram: values below 32 are exact,
+// above that every power of two is split into 16 sub-buckets (~6% precision).
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketLowerBound(size_t index);
+
+    // Called only by the owning thread; readers may run concurrently.
+    void Record(uint64_t value) {
+        buckets_[GetBucketIndex(value)].fetch_add(1, memory_order_relaxed);
+        sum_.fetch_add(value, memory_order_relaxed);
+        if (value > max_.load(memory_order_relaxed)) {
+            max_.store(value, memory_order_relaxed);
+        }
+    }
+
+    void MergeInto(vector<uint64_t>& buckets, uint64_t& sum, uint64_t& max) const;
+    void Reset();
+
+private:
+    array<atomic<uint64_t>, BUCKET_COUNT> buckets_ = {};
+    atomic<uint64_t> sum_ = 0;
+    atomic<uint64_t> max_ = 0;
+};
+
+struct HistogramSnapshot {
+    vector<uint64_t> buckets = vector<uint64_t>(LatencyHistogram::BUCKET_COUNT);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    double Mean() const;
+    uint64_t Percentile(double p) const;
+};
+
+struct MetricsSnapshot {
+    array<HistogramSnapshot, static_cast<size_t>(Timer::COUNT)> timers;
+    array<uint64_t, static_cast<size_t>(Counter::COUNT)> counters = {};
+
+    void PrintText(ostream& out) const;
+    void PrintJson(ostream& out) const;
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& Instance();
+
+    void Record(Timer timer, uint64_t nanoseconds) {
+        GetLocalShard().timers[static_cast<size_t>(timer)].Record(nanoseconds);
+    }
+
+    void Add(Counter counter, uint64_t value) {
+        GetLocalShard().counters[static_cast<size_t>(counter)].fetch_add(value, memory_order_relaxed);
+    }
+
+    MetricsSnapshot GetSnapshot() const;
+    void Reset();
+    // Bounded by the largest number of threads that have recorded at the same time.
+    size_t GetShardCount() const;
+
+private:
+    struct Shard {
+        array<LatencyHistogram, static_cast<size_t>(Timer::COUNT)> timers;
+        array<atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)> counters = {};
+    };
+
+    // Hands the shard back when its thread exits. The next thread to record takes it
+    // over, values included, so short-lived threads do not leave a shard each behind.
+    struct ShardLease {
+        Shard* shard = nullptr;
+        ~ShardLease();
+    };
+
+    MetricsRegistry() = default;
+
+    Shard& GetLocalShard() {
+        thread_local ShardLease lease;
+        if (lease.shard == nullptr) {
+            lease.shard = &AcquireShard();
+        }
+        return *lease.shard;
+    }
+
+    Shard& AcquireShard();
+    void ReleaseShard(Shard& shard);
+
+    mutable mutex mutex_;
+    deque<unique_ptr<Shard>> shards_;
+    vector<Shard*> free_shards_;
+};
+
+class ScopedTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedTimer(Timer timer)
+        : timer_(timer) {
+    }
+
+    ~ScopedTimer() {
+        const auto duration = Clock::now() - start_time_;
+        MetricsRegistry::Instance().Record(timer_,
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    }
+
+private:
+    const Timer timer_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+#ifdef SEARCH_SERVER_DISABLE_METRICS
+#define METRICS_TIMER(timer)
+#define METRICS_ADD(counter, value)
+#else
+#define METRICS_TIMER(timer) ScopedTimer UNIQUE_VAR_NAME_PROFILE(timer)
+#define METRICS_ADD(counter, value) MetricsRegistry::Instance().Add((counter), (value))
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+using namespace std;
+
+// Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's design).
+// Every cell carries a sequence number telling whether it is ready to be written
+// or read at the current lap; producers and consumers claim positions with CAS.
+// Values live in their cells only between a push and the matching pop.
+template <typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity)
+        : capacity_(RoundUpToPowerOfTwo(capacity))
+        , mask_(capacity_ - 1)
+        , cells_(make_unique<Cell[]>(capacity_)) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    bool TryPush(T& value) {
+        size_t position = enqueue_position_.load(memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[position & mask_];
+            const size_t sequence = cell.sequence.load(memory_order_acquire);
+            const auto difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+            if (difference == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                    cell.data.emplace(move(value));
+                    cell.sequence.store(position + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = enqueue_position_.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& value) {
+        size_t position = dequeue_position_.load(memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[position & mask_];
+            const size_t sequence = cell.sequence.load(memory_order_acquire);
+            const auto difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position + 1);
+            if (difference == 0) {
+                if (dequeue_position_.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                    value = move(*cell.data);
+                    cell.data.reset();
+                    cell.sequence.store(position + mask_ + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = dequeue_position_.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate under concurrent access.
+    size_t Size() const {
+        const size_t enqueued = enqueue_position_.load(memory_order_relaxed);
+        const size_t dequeued = dequeue_position_.load(memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+private:
+    struct Cell {
+        atomic<size_t> sequence;
+        optional<T> data;
+    };
+
+    static size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    unique_ptr<Cell[]> cells_;
+    alignas(64) atomic<size_t> enqueue_position_ = 0;
+    alignas(64) atomic<size_t> dequeue_position_ = 0;
+};
@@ -0,0 +1,422 @@
+#include "mutation_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mapped_corpus.h"
+#include "search_server.h"
+
+namespace {
+
+constexpr string_view MAGIC = "SSMLOG01"sv;
+constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+enum class RecordType : uint8_t {
+    ADD = 1,
+    REMOVE = 2,
+};
+
+struct LogRecord {
+    RecordType type = RecordType::ADD;
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    vector<int> ratings;
+    // Points into the log data.
+    string_view text;
+};
+
+// Records that passed the checksum and decoded cleanly, up to the first one that
+// did not; intact_size is where that one starts.
+struct LogContents {
+    vector<LogRecord> records;
+    size_t intact_size = 0;
+};
+
+const array<uint32_t, 256> CRC32_TABLE = [] {
+    array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < table.size(); ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+uint32_t ComputeCrc32(string_view data) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (const char c : data) {
+        crc = CRC32_TABLE[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void Put(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Get(string_view& in, T& value) {
+    if (in.size() < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+string MakeRecord(string_view payload) {
+    string record;
+    record.reserve(RECORD_HEADER_SIZE + payload.size());
+    Put(record, static_cast<uint32_t>(payload.size()));
+    Put(record, ComputeCrc32(payload));
+    record += payload;
+    return record;
+}
+
+bool DecodeRecord(string_view payload, LogRecord& record) {
+    uint8_t type = 0;
+    int32_t id = 0;
+    if (!Get(payload, type) || !Get(payload, id)) {
+        return false;
+    }
+    record.id = id;
+    if (type == static_cast<uint8_t>(RecordType::REMOVE)) {
+        record.type = RecordType::REMOVE;
+        return payload.empty();
+    }
+    if (type != static_cast<uint8_t>(RecordType::ADD)) {
+        return false;
+    }
+    record.type = RecordType::ADD;
+
+    uint8_t status = 0;
+    uint32_t rating_count = 0;
+    if (!Get(payload, status) || status > static_cast<uint8_t>(DocumentStatus::REMOVED)
+        || !Get(payload, rating_count) || rating_count > payload.size() / sizeof(int32_t)) {
+        return false;
+    }
+    record.status = static_cast<DocumentStatus>(status);
+    record.ratings.resize(rating_count);
+    for (int& rating : record.ratings) {
+        int32_t value = 0;
+        Get(payload, value);
+        rating = value;
+    }
+    uint32_t text_size = 0;
+    if (!Get(payload, text_size) || text_size != payload.size()) {
+        return false;
+    }
+    record.text = payload;
+    return true;
+}
+
+// Record boundaries are found by hopping over the size fields, which is cheap;
+// checksums and decoding, which touch every byte, run in parallel.
+LogContents ReadLog(string_view data, const string& path) {
+    LogContents contents;
+    // A crash while the log was being created can leave part of the magic.
+    if (data.size() < MAGIC.size() && MAGIC.substr(0, data.size()) == data) {
+        return contents;
+    }
+    if (data.substr(0, MAGIC.size()) != MAGIC) {
+        throw runtime_error("Not a mutation log: "s + path);
+    }
+
+    vector<size_t> offsets;
+    size_t offset = MAGIC.size();
+    while (data.size() - offset >= RECORD_HEADER_SIZE) {
+        uint32_t payload_size = 0;
+        memcpy(&payload_size, data.data() + offset, sizeof(payload_size));
+        if (data.size() - offset - RECORD_HEADER_SIZE < payload_size) {
+            break;
+        }
+        offsets.push_back(offset);
+        offset += RECORD_HEADER_SIZE + payload_size;
+    }
+
+    contents.records.resize(offsets.size());
+    vector<char> intact(offsets.size());
+    vector<size_t> indexes(offsets.size());
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t i) {
+        string_view header = data.substr(offsets[i], RECORD_HEADER_SIZE);
+        uint32_t payload_size = 0;
+        uint32_t checksum = 0;
+        Get(header, payload_size);
+        Get(header, checksum);
+        const string_view payload = data.substr(offsets[i] + RECORD_HEADER_SIZE, payload_size);
+        intact[i] = ComputeCrc32(payload) == checksum && DecodeRecord(payload, contents.records[i]);
+    });
+
+    const size_t intact_count = static_cast<size_t>(find(intact.begin(), intact.end(), 0) - intact.begin());
+    contents.records.resize(intact_count);
+    contents.intact_size = intact_count == offsets.size() ? offset : offsets[intact_count];
+    return contents;
+}
+
+bool WriteAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+// Makes a created or renamed file's directory entry durable.
+void SyncDirectory(const string& path) {
+    const filesystem::path parent = filesystem::path(path).parent_path();
+    const int fd = open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+string DescribeError(const string& action, const string& path) {
+    return action + " "s + path + ": "s + strerror(errno);
+}
+
+}  // namespace
+
+MutationLog::MutationLog(const string& path, MutationLogOptions options)
+    : path_(path)
+    , options_(options) {
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw runtime_error(DescribeError("Cannot open"s, path_));
+    }
+    const size_t size = filesystem::file_size(path_);
+    size_t intact_size = 0;
+    if (size > 0) {
+        const MappedFile file(path_);
+        intact_size = ReadLog(file.GetData(), path_).intact_size;
+    }
+    if (intact_size == 0) {
+        if (ftruncate(fd_, 0) != 0 || !WriteAll(fd_, MAGIC) || fsync(fd_) != 0) {
+            close(fd_);
+            throw runtime_error(DescribeError("Cannot initialize"s, path_));
+        }
+        SyncDirectory(path_);
+    }
+    else if (intact_size < size) {
+        if (ftruncate(fd_, static_cast<off_t>(intact_size)) != 0 || fsync(fd_) != 0) {
+            close(fd_);
+            throw runtime_error(DescribeError("Cannot cut the torn tail of"s, path_));
+        }
+    }
+    committer_ = thread(&MutationLog::RunCommitter, this);
+}
+
+MutationLog::~MutationLog() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    appended_.notify_all();
+    committer_.join();
+    close(fd_);
+}
+
+void MutationLog::AppendAdd(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    string payload;
+    payload.reserve(14 + ratings.size() * sizeof(int32_t) + document.size());
+    Put(payload, static_cast<uint8_t>(RecordType::ADD));
+    Put(payload, static_cast<int32_t>(document_id));
+    Put(payload, static_cast<uint8_t>(status));
+    Put(payload, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        Put(payload, static_cast<int32_t>(rating));
+    }
+    Put(payload, static_cast<uint32_t>(document.size()));
+    payload += document;
+    Append(MakeRecord(payload));
+}
+
+void MutationLog::AppendRemove(int document_id) {
+    string payload;
+    Put(payload, static_cast<uint8_t>(RecordType::REMOVE));
+    Put(payload, static_cast<int32_t>(document_id));
+    Append(MakeRecord(payload));
+}
+
+void MutationLog::Sync() {
+    unique_lock lock(mutex_);
+    WaitForCommit(lock, appended_records_);
+}
+
+void MutationLog::Truncate() {
+    Sync();
+    lock_guard file_lock(file_mutex_);
+    const string temporary_path = path_ + ".tmp"s;
+    const int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw runtime_error(DescribeError("Cannot create"s, temporary_path));
+    }
+    const bool written = WriteAll(fd, MAGIC) && fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(temporary_path.c_str(), path_.c_str()) != 0) {
+        throw runtime_error(DescribeError("Cannot replace"s, path_));
+    }
+    SyncDirectory(path_);
+
+    const int new_fd = open(path_.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if (new_fd < 0) {
+        throw runtime_error(DescribeError("Cannot reopen"s, path_));
+    }
+    close(fd_);
+    fd_ = new_fd;
+}
+
+const string& MutationLog::GetPath() const {
+    return path_;
+}
+
+uint64_t MutationLog::GetCommitCount() const {
+    lock_guard lock(mutex_);
+    return commits_;
+}
+
+void MutationLog::Append(const string& record) {
+    unique_lock lock(mutex_);
+    if (!error_.empty()) {
+        throw runtime_error(error_);
+    }
+    pending_ += record;
+    const uint64_t number = ++appended_records_;
+    if (options_.wait_for_commit) {
+        WaitForCommit(lock, number);
+    }
+    else if (pending_.size() == record.size() || pending_.size() >= options_.commit_bytes) {
+        // The committer only needs a nudge to start a group or to cut it short.
+        appended_.notify_one();
+    }
+}
+
+void MutationLog::WaitForCommit(unique_lock<mutex>& lock, uint64_t record) {
+    if (committed_records_ >= record) {
+        return;
+    }
+    ++commit_waiters_;
+    appended_.notify_one();
+    committed_.wait(lock, [&] {
+        return committed_records_ >= record || !error_.empty();
+    });
+    --commit_waiters_;
+    if (committed_records_ < record) {
+        throw runtime_error(error_);
+    }
+}
+
+// A group starts with the first pending record and is committed once the interval
+// passes, it grows past commit_bytes or somebody waits for it. Records appended
+// while a group is being synced form the next group.
+void MutationLog::RunCommitter() {
+    string group;
+    unique_lock lock(mutex_);
+    while (true) {
+        appended_.wait(lock, [&] {
+            return stopping_ || !pending_.empty();
+        });
+        if (pending_.empty()) {
+            return;
+        }
+        appended_.wait_for(lock, options_.commit_interval, [&] {
+            return stopping_ || commit_waiters_ > 0 || pending_.size() >= options_.commit_bytes;
+        });
+
+        group.clear();
+        group.swap(pending_);
+        const uint64_t group_end = appended_records_;
+        lock.unlock();
+        string error;
+        {
+            lock_guard file_lock(file_mutex_);
+            if (!WriteAll(fd_, group)) {
+                error = DescribeError("Cannot write"s, path_);
+            }
+            else if (fdatasync(fd_) != 0) {
+                error = DescribeError("Cannot sync"s, path_);
+            }
+        }
+        lock.lock();
+
+        if (!error.empty()) {
+            error_ = move(error);
+            committed_.notify_all();
+            return;
+        }
+        committed_records_ = group_end;
+        ++commits_;
+        committed_.notify_all();
+    }
+}
+
+MutationLogReplay ReplayMutationLog(SearchServer& search_server, const string& path) {
+    MutationLogReplay replay;
+    if (!filesystem::exists(path)) {
+        return replay;
+    }
+    auto file = make_shared<const MappedFile>(path);
+    const LogContents contents = ReadLog(file->GetData(), path);
+    replay.records = contents.records.size();
+    replay.discarded_bytes = file->GetData().size() - min(contents.intact_size, file->GetData().size());
+
+    // Only the last mutation of a document matters.
+    unordered_map<int, size_t> last_mutation;
+    for (size_t i = 0; i < contents.records.size(); ++i) {
+        last_mutation[contents.records[i].id] = i;
+    }
+
+    search_server.KeepAlive(file);
+    for (size_t i = 0; i < contents.records.size(); ++i) {
+        const LogRecord& record = contents.records[i];
+        if (last_mutation.at(record.id) != i) {
+            continue;
+        }
+        const int document_count = search_server.GetDocumentCount();
+        search_server.RemoveDocument(record.id);
+        if (record.type == RecordType::ADD) {
+            search_server.AddExternalDocument(record.id, record.text, record.status, record.ratings);
+            ++replay.added;
+        }
+        else if (search_server.GetDocumentCount() < document_count) {
+            ++replay.removed;
+        }
+    }
+    return replay;
+}
+
+MutationLogReplay InspectMutationLog(const string& path) {
+    MutationLogReplay replay;
+    if (!filesystem::exists(path)) {
+        return replay;
+    }
+    const MappedFile file(path);
+    const LogContents contents = ReadLog(file.GetData(), path);
+    replay.records = contents.records.size();
+    replay.discarded_bytes = file.GetData().size() - min(contents.intact_size, file.GetData().size());
+    for (const LogRecord& record : contents.records) {
+        ++(record.type == RecordType::ADD ? replay.added : replay.removed);
+    }
+    return replay;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+using namespace std;
+
+class SearchServer;
+
+struct MutationLogOptions {
+    // A group is committed (written and synced) this long after its first record,
+    // or as soon as it reaches commit_bytes.
+    chrono::microseconds commit_interval{ 2000 };
+    size_t commit_bytes = 1 << 20;
+    // Make every append wait until its group is on disk. Concurrent writers still
+    // share one fsync per group; without it up to one group is lost on a crash.
+    bool wait_for_commit = false;
+};
+
+// Append-only log of AddDocument and RemoveDocument calls, kept on disk so that
+// they survive a restart: replaying it on top of the corpus the server was started
+// from gives back the index. The file is an 8-byte magic followed by records
+//     <uint32 payload size> <uint32 CRC-32 of payload> <payload>
+// with the payload
+//     ADD:    <uint8 1> <int32 id> <uint8 status> <uint32 n> <int32 rating> * n <uint32 size> <text>
+//     REMOVE: <uint8 2> <int32 id>
+// in host byte order. A torn or corrupt record ends the log.
+// Records are encoded by the caller's thread; a background thread writes and
+// syncs them in groups.
+class MutationLog {
+public:
+    // Opens the log, creating it if needed, and cuts off a torn tail left by a crash.
+    explicit MutationLog(const string& path, MutationLogOptions options = {});
+    // Commits whatever is still pending.
+    ~MutationLog();
+
+    MutationLog(const MutationLog&) = delete;
+    MutationLog& operator=(const MutationLog&) = delete;
+
+    void AppendAdd(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings);
+    void AppendRemove(int document_id);
+
+    // Blocks until every record appended so far is on disk.
+    void Sync();
+    // Empties the log once a snapshot covers all of its records. No appends may run
+    // concurrently. The file is replaced, not cut, so mappings made by
+    // ReplayMutationLog stay valid.
+    void Truncate();
+
+    const string& GetPath() const;
+    // Number of fsync calls made for appended records.
+    uint64_t GetCommitCount() const;
+
+private:
+    string path_;
+    MutationLogOptions options_;
+    int fd_ = -1;
+
+    mutable mutex mutex_;
+    condition_variable appended_;
+    condition_variable committed_;
+    string pending_;
+    uint64_t appended_records_ = 0;
+    uint64_t committed_records_ = 0;
+    size_t commit_waiters_ = 0;
+    uint64_t commits_ = 0;
+    string error_;
+    bool stopping_ = false;
+    // Held while the file is written, synced or replaced.
+    mutex file_mutex_;
+    thread committer_;
+
+    void Append(const string& record);
+    void WaitForCommit(unique_lock<mutex>& lock, uint64_t record);
+    void RunCommitter();
+};
+
+struct MutationLogReplay {
+    size_t records = 0;
+    size_t added = 0;
+    size_t removed = 0;
+    // Bytes after the last intact record.
+    size_t discarded_bytes = 0;
+};
+
+// Applies the log on top of the server's current contents. Records are verified
+// and decoded in parallel and reduced to the last mutation of every document, so
+// replay is idempotent: documents already in the server are replaced, and a log
+// that was not truncated after a snapshot does no harm. Texts are indexed in place
+// from a mapping of the log, which the server keeps alive. Attach the log to the
+// server (SetMutationLog) only after replaying it. A missing file is an empty log.
+MutationLogReplay ReplayMutationLog(SearchServer& search_server, const string& path);
+
+// Record count, intact size and torn tail of the log file, without applying it.
+MutationLogReplay InspectMutationLog(const string& path);
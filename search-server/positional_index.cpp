@@ -0,0 +1,124 @@
+#include "positional_index.h"
+
+PositionalIndex::PositionalIndex(pmr::memory_resource* memory)
+    : word_to_document_positions_(memory) {
+}
+
+void PositionalIndex::AddDocument(int document_id, const vector<string_view>& words, const vector<uint32_t>& positions) {
+    map<string_view, vector<uint32_t>> word_positions;
+    for (size_t i = 0; i < words.size(); ++i) {
+        word_positions[words[i]].push_back(positions[i]);
+    }
+    for (const auto& [word, word_positions_list] : word_positions) {
+        pmr::vector<uint8_t>& encoded = word_to_document_positions_[word][document_id];
+        EncodePositions(word_positions_list, encoded);
+        encoded.shrink_to_fit();
+        encoded_size_ += encoded.size();
+        ++list_count_;
+    }
+}
+
+void PositionalIndex::RemoveDocument(int document_id, const vector<string_view>& words) {
+    for (const string_view word : words) {
+        const auto word_it = word_to_document_positions_.find(word);
+        if (word_it == word_to_document_positions_.end()) {
+            continue;
+        }
+        const auto document_it = word_it->second.find(document_id);
+        if (document_it == word_it->second.end()) {
+            continue;
+        }
+        encoded_size_ -= document_it->second.size();
+        --list_count_;
+        word_it->second.erase(document_it);
+        if (word_it->second.empty()) {
+            word_to_document_positions_.erase(word_it);
+        }
+    }
+}
+
+bool PositionalIndex::MatchesPhrase(int document_id, const Phrase& phrase) const {
+    if (phrase.words.empty()) {
+        return true;
+    }
+
+    thread_local vector<vector<uint32_t>> lists;
+    lists.resize(phrase.words.size());
+    for (size_t i = 0; i < phrase.words.size(); ++i) {
+        const auto word_it = word_to_document_positions_.find(phrase.words[i]);
+        if (word_it == word_to_document_positions_.end()) {
+            return false;
+        }
+        const auto document_it = word_it->second.find(document_id);
+        if (document_it == word_it->second.end()) {
+            return false;
+        }
+        DecodePositions(document_it->second, lists[i]);
+    }
+
+    // Merged walk: candidate start = position - offset must agree for all words.
+    vector<size_t> cursors(lists.size(), 0);
+    int64_t start = static_cast<int64_t>(lists[0][0]) - phrase.offsets[0];
+    for (;;) {
+        bool aligned = true;
+        for (size_t i = 0; i < lists.size(); ++i) {
+            const vector<uint32_t>& list = lists[i];
+            size_t& cursor = cursors[i];
+            const int64_t target = start + phrase.offsets[i];
+            while (cursor < list.size() && static_cast<int64_t>(list[cursor]) < target) {
+                ++cursor;
+            }
+            if (cursor == list.size()) {
+                return false;
+            }
+            if (static_cast<int64_t>(list[cursor]) > target) {
+                start = static_cast<int64_t>(list[cursor]) - phrase.offsets[i];
+                aligned = false;
+                break;
+            }
+        }
+        if (aligned) {
+            return true;
+        }
+    }
+}
+
+size_t PositionalIndex::GetEncodedSize() const {
+    return encoded_size_;
+}
+
+size_t PositionalIndex::GetListCount() const {
+    return list_count_;
+}
+
+void PositionalIndex::EncodePositions(const vector<uint32_t>& positions, pmr::vector<uint8_t>& out) {
+    out.clear();
+    uint32_t previous = 0;
+    for (const uint32_t position : positions) {
+        uint32_t delta = position - previous;
+        previous = position;
+        while (delta >= 0x80) {
+            out.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(delta));
+    }
+}
+
+void PositionalIndex::DecodePositions(const pmr::vector<uint8_t>& encoded, vector<uint32_t>& out) {
+    out.clear();
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const uint8_t byte : encoded) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += delta;
+        out.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+}
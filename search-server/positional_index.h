@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Quoted part of a query. Stop words are not stored but keep their place:
+// in "cat in the city" (with "in" and "the" as stop words) city has offset 3.
+struct Phrase {
+    vector<string_view> words;
+    vector<uint32_t> offsets;
+};
+
+// Word positions of every (word, document) pair, delta- and varint-encoded.
+class PositionalIndex {
+public:
+    explicit PositionalIndex(pmr::memory_resource* memory = pmr::get_default_resource());
+
+    // positions[i] is the position of words[i] in the document.
+    void AddDocument(int document_id, const vector<string_view>& words, const vector<uint32_t>& positions);
+    void RemoveDocument(int document_id, const vector<string_view>& words);
+
+    bool MatchesPhrase(int document_id, const Phrase& phrase) const;
+
+    // Bytes of encoded position lists.
+    size_t GetEncodedSize() const;
+    // Position lists, one per (word, document) pair.
+    size_t GetListCount() const;
+
+    static void EncodePositions(const vector<uint32_t>& positions, pmr::vector<uint8_t>& out);
+    static void DecodePositions(const pmr::vector<uint8_t>& encoded, vector<uint32_t>& out);
+
+private:
+    pmr::map<string_view, pmr::map<int, pmr::vector<uint8_t>>> word_to_document_positions_;
+    size_t encoded_size_ = 0;
+    size_t list_count_ = 0;
+};
@@ -0,0 +1,127 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+PostingList::PostingList(const allocator_type& allocator)
+    : document_ids_(allocator)
+    , term_freqs_(allocator)
+    , document_lengths_(allocator) {
+}
+
+PostingList::PostingList(const PostingList& other, const allocator_type& allocator)
+    : document_ids_(other.document_ids_, allocator)
+    , term_freqs_(other.term_freqs_, allocator)
+    , document_lengths_(other.document_lengths_, allocator) {
+}
+
+PostingList::PostingList(PostingList&& other, const allocator_type& allocator)
+    : document_ids_(move(other.document_ids_), allocator)
+    , term_freqs_(move(other.term_freqs_), allocator)
+    , document_lengths_(move(other.document_lengths_), allocator) {
+}
+
+void PostingList::Add(int document_id, double term_freq, uint32_t document_length) {
+    if (document_ids_.empty() || document_ids_.back() < document_id) {
+        document_ids_.push_back(document_id);
+        term_freqs_.push_back(term_freq);
+        document_lengths_.push_back(document_length);
+        return;
+    }
+    if (document_ids_.back() == document_id) {
+        term_freqs_.back() += term_freq;
+        return;
+    }
+    const size_t index = LowerBound(document_id);
+    if (document_ids_[index] == document_id) {
+        term_freqs_[index] += term_freq;
+        return;
+    }
+    document_ids_.insert(document_ids_.begin() + index, document_id);
+    term_freqs_.insert(term_freqs_.begin() + index, term_freq);
+    document_lengths_.insert(document_lengths_.begin() + index, document_length);
+}
+
+void PostingList::Update(int document_id, double term_freq, uint32_t document_length) {
+    const size_t index = LowerBound(document_id);
+    term_freqs_[index] = term_freq;
+    document_lengths_[index] = document_length;
+}
+
+size_t PostingList::erase(int document_id) {
+    const size_t index = LowerBound(document_id);
+    if (index == document_ids_.size() || document_ids_[index] != document_id) {
+        return 0;
+    }
+    document_ids_.erase(document_ids_.begin() + index);
+    term_freqs_.erase(term_freqs_.begin() + index);
+    document_lengths_.erase(document_lengths_.begin() + index);
+    return 1;
+}
+
+size_t PostingList::count(int document_id) const {
+    return binary_search(document_ids_.begin(), document_ids_.end(), document_id) ? 1 : 0;
+}
+
+size_t PostingList::Seek(int document_id, size_t from) const {
+    const size_t size = document_ids_.size();
+    if (from >= size || document_ids_[from] >= document_id) {
+        return from;
+    }
+    // Invariant: document_ids_[low] < document_id.
+    size_t low = from;
+    size_t step = 1;
+    while (low + step < size && document_ids_[low + step] < document_id) {
+        low += step;
+        step *= 2;
+    }
+    const auto first = document_ids_.begin() + low + 1;
+    const auto last = document_ids_.begin() + min(low + step + 1, size);
+    return static_cast<size_t>(lower_bound(first, last, document_id) - document_ids_.begin());
+}
+
+void PostingList::IntersectWith(vector<int>& document_ids) const {
+    size_t position = 0;
+    size_t kept = 0;
+    for (const int document_id : document_ids) {
+        position = Seek(document_id, position);
+        if (position == document_ids_.size()) {
+            break;
+        }
+        if (document_ids_[position] == document_id) {
+            document_ids[kept++] = document_id;
+        }
+    }
+    document_ids.resize(kept);
+}
+
+size_t PostingList::size() const {
+    return document_ids_.size();
+}
+
+bool PostingList::empty() const {
+    return document_ids_.empty();
+}
+
+PostingList::const_iterator PostingList::begin() const {
+    return { this, 0 };
+}
+
+PostingList::const_iterator PostingList::end() const {
+    return { this, document_ids_.size() };
+}
+
+const int* PostingList::GetDocumentIds() const {
+    return document_ids_.data();
+}
+
+const double* PostingList::GetTermFreqs() const {
+    return term_freqs_.data();
+}
+
+const uint32_t* PostingList::GetDocumentLengths() const {
+    return document_lengths_.data();
+}
+
+size_t PostingList::LowerBound(int document_id) const {
+    return static_cast<size_t>(lower_bound(document_ids_.begin(), document_ids_.end(), document_id) - document_ids_.begin());
+}
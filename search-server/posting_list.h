@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Documents containing one word, sorted by id. Stored column-wise, so that the
+// scoring kernels run over contiguous arrays of frequencies and lengths.
+// Iteration yields (document id, term frequency) pairs, as a map<int, double> would.
+class PostingList {
+public:
+    using allocator_type = pmr::polymorphic_allocator<byte>;
+    class const_iterator;
+
+    PostingList() = default;
+    explicit PostingList(const allocator_type& allocator);
+    PostingList(const PostingList& other, const allocator_type& allocator);
+    PostingList(PostingList&& other, const allocator_type& allocator);
+
+    // Adds term_freq to the document's frequency, inserting the document if needed.
+    // Appending ids in increasing order is amortized O(1); inserting before the last
+    // id shifts the postings after it, O(size()).
+    void Add(int document_id, double term_freq, uint32_t document_length);
+    // Overwrites the frequency and length of a document already in the list.
+    void Update(int document_id, double term_freq, uint32_t document_length);
+    // Shifts the postings after the document, O(size()) like an out-of-order Add:
+    // removing most documents of a common word costs O(size()^2) unless the highest
+    // ids go first (the remove_common_word benchmark). The columns stay gap-free,
+    // so that the scoring kernels need not skip tombstones.
+    size_t erase(int document_id);
+    size_t count(int document_id) const;
+
+    // First position at or after from whose document id is not less than
+    // document_id, or size(). Gallops: the cost is logarithmic in the distance
+    // skipped, so walking a short id list through a long posting list is cheap.
+    size_t Seek(int document_id, size_t from = 0) const;
+    // Keeps the ids, sorted ascending, that are also in this list.
+    void IntersectWith(vector<int>& document_ids) const;
+
+    size_t size() const;
+    bool empty() const;
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    const int* GetDocumentIds() const;
+    const double* GetTermFreqs() const;
+    // Non-stop words in each document.
+    const uint32_t* GetDocumentLengths() const;
+
+private:
+    pmr::vector<int> document_ids_;
+    pmr::vector<double> term_freqs_;
+    pmr::vector<uint32_t> document_lengths_;
+
+    size_t LowerBound(int document_id) const;
+};
+
+class PostingList::const_iterator {
+public:
+    using iterator_category = random_access_iterator_tag;
+    using value_type = pair<int, double>;
+    using difference_type = ptrdiff_t;
+    using reference = value_type;
+
+    struct pointer {
+        value_type value;
+
+        const value_type* operator->() const {
+            return &value;
+        }
+    };
+
+    const_iterator() = default;
+
+    const_iterator(const PostingList* list, size_t index)
+        : list_(list)
+        , index_(index) {
+    }
+
+    reference operator*() const {
+        return { list_->document_ids_[index_], list_->term_freqs_[index_] };
+    }
+
+    pointer operator->() const {
+        return { **this };
+    }
+
+    reference operator[](difference_type offset) const {
+        return *(*this + offset);
+    }
+
+    const_iterator& operator++() {
+        ++index_;
+        return *this;
+    }
+
+    const_iterator operator++(int) {
+        const_iterator old = *this;
+        ++index_;
+        return old;
+    }
+
+    const_iterator& operator--() {
+        --index_;
+        return *this;
+    }
+
+    const_iterator operator--(int) {
+        const_iterator old = *this;
+        --index_;
+        return old;
+    }
+
+    const_iterator& operator+=(difference_type offset) {
+        index_ += offset;
+        return *this;
+    }
+
+    const_iterator& operator-=(difference_type offset) {
+        index_ -= offset;
+        return *this;
+    }
+
+    friend const_iterator operator+(const_iterator it, difference_type offset) {
+        return it += offset;
+    }
+
+    friend const_iterator operator+(difference_type offset, const_iterator it) {
+        return it += offset;
+    }
+
+    friend const_iterator operator-(const_iterator it, difference_type offset) {
+        return it -= offset;
+    }
+
+    friend difference_type operator-(const const_iterator& lhs, const const_iterator& rhs) {
+        return static_cast<difference_type>(lhs.index_) - static_cast<difference_type>(rhs.index_);
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ == rhs.index_;
+    }
+
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ != rhs.index_;
+    }
+
+    friend bool operator<(const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ < rhs.index_;
+    }
+
+    friend bool operator>(const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ > rhs.index_;
+    }
+
+    friend bool operator<=(const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ <= rhs.index_;
+    }
+
+    friend bool operator>=(const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ >= rhs.index_;
+    }
+
+private:
+    const PostingList* list_ = nullptr;
+    size_t index_ = 0;
+};
@@ -1,11 +1,20 @@
 #include "process_queries.h"
 
+#include "workload.h"
+
 using namespace std;
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries) {
-    
+    const std::vector<std::string>& queries,
+    WorkloadRecorder* recorder) {
+    METRICS_TIMER(Timer::PROCESS_QUERIES);
+    if (recorder != nullptr) {
+        for (const string& query : queries) {
+            recorder->Record(query);
+        }
+    }
+
     std::vector<std::vector<Document>> res(queries.size());
     
     std::transform(
@@ -21,9 +30,10 @@ std::vector<std::vector<Document>> ProcessQueries(
 
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries) {
+    const std::vector<std::string>& queries,
+    WorkloadRecorder* recorder) {
     
-    auto intermediate_result = ProcessQueries(search_server, queries);
+    auto intermediate_result = ProcessQueries(search_server, queries, recorder);
     size_t final_size = 0;
     for (const auto& documents : intermediate_result) {
         final_size += documents.size();
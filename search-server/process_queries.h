@@ -7,10 +7,15 @@
 
 #include "search_server.h"
 
+class WorkloadRecorder;
+
+// With a recorder, the queries are captured as one batch arriving at once.
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
+    const std::vector<std::string>& queries,
+    WorkloadRecorder* recorder = nullptr);
 
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries,
+    WorkloadRecorder* recorder = nullptr);
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include "query_profile.h"
+
+ostream& operator<<(ostream& out, const QueryProfile& profile) {
+    out << "parse = "s << profile.parse_time.count() << " ns, "s
+        << "scoring = "s << profile.scoring_time.count() << " ns, "s
+        << "sort = "s << profile.sort_time.count() << " ns\n"s;
+    for (const TermProfile& term : profile.terms) {
+        out << "  "s << (term.is_minus ? "-"s : ""s) << term.word
+            << ": postings = "s << term.postings
+            << ", idf = "s << term.inverse_document_freq
+            << ", kept = "s << term.kept
+            << ", rejected = "s << term.rejected << '\n';
+    }
+    out << "candidates = "s << profile.candidates
+        << ", removed by minus words = "s << profile.removed_by_minus_words
+        << ", results = "s << profile.results << '\n';
+    return out;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct TermProfile {
+    // A copy: the query text and expanded terms are gone once the search returns.
+    string word;
+    bool is_minus = false;
+    size_t postings = 0;
+    double inverse_document_freq = 0;
+    // Plus-words: postings accepted and rejected by the document predicate.
+    // Minus-words: rejected is the number of candidates the word kept out of scoring.
+    size_t kept = 0;
+    size_t rejected = 0;
+};
+
+// Filled by the profiling overloads of FindTopDocuments and MatchDocument.
+struct QueryProfile {
+    chrono::nanoseconds parse_time{};
+    chrono::nanoseconds scoring_time{};
+    chrono::nanoseconds sort_time{};
+    vector<TermProfile> terms;
+    size_t candidates = 0;
+    size_t removed_by_minus_words = 0;
+    size_t results = 0;
+};
+
+ostream& operator<<(ostream& out, const QueryProfile& profile);
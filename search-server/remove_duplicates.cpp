@@ -11,7 +11,7 @@ void RemoveDuplicates(SearchServer& search_server) {
     for (auto i : search_server) {
         std::set<std::string> words;
         for (auto j : search_server.GetWordFrequencies(i)) {
-            words.insert(j.first); 
+            words.insert(std::string(j.first));
         }
         if (docs_to_compare.find(words) == docs_to_compare.end()) {
             docs_to_compare[words];
@@ -1,39 +1,220 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
+#include "workload.h"
+
+namespace {
+
+void Backoff(int& idle_rounds) {
+    if (idle_rounds < 64) {
+        ++idle_rounds;
+        this_thread::yield();
+    }
+    else {
+        this_thread::sleep_for(chrono::microseconds(100));
+    }
+}
+
+}  // namespace
+
+RequestQueue::RequestQueue(const SearchServer& search_server, RequestQueueOptions options)
     : search_server_(search_server)
-    , no_results_requests_(0)
-    , current_time_(0) {
+    , options_(options)
+    , tasks_(options.capacity)
+    , buckets_(make_unique<WindowBucket[]>(options.bucket_count)) {
+    if (options_.bucket_count == 0 || options_.bucket_duration <= Clock::duration::zero()) {
+        throw invalid_argument("Invalid statistics window"s);
+    }
+    workers_.reserve(options_.workers);
+    for (size_t i = 0; i < options_.workers; ++i) {
+        workers_.emplace_back([this] { RunWorker(); });
+    }
+}
+
+RequestQueue::~RequestQueue() {
+    {
+        lock_guard lock(idle_mutex_);
+        stopping_.store(true, memory_order_release);
+    }
+    work_available_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
+    RecordArrival(raw_query, status);
+    const auto start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(static_cast<int>(result.size()));
+    RecordRequest(result.size(), start);
     return result;
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
+    RecordArrival(raw_query, DocumentStatus::ACTUAL);
+    const auto start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(static_cast<int>(result.size()));
+    RecordRequest(result.size(), start);
+    return result;
+}
+
+future<vector<Document>> RequestQueue::Submit(string raw_query, DocumentStatus status) {
+    if (workers_.empty()) {
+        throw logic_error("Request queue has no workers"s);
+    }
+    RecordArrival(raw_query, status);
+    Task task{ move(raw_query), status, {}, Clock::now() };
+    auto result = task.result.get_future();
+    int idle_rounds = 0;
+    while (!tasks_.TryPush(task)) {
+        Backoff(idle_rounds);
+    }
+    WakeWorker();
+    return result;
+}
+
+optional<future<vector<Document>>> RequestQueue::TrySubmit(string raw_query, DocumentStatus status) {
+    if (workers_.empty()) {
+        throw logic_error("Request queue has no workers"s);
+    }
+    RecordArrival(raw_query, status);
+    Task task{ move(raw_query), status, {}, Clock::now() };
+    auto result = task.result.get_future();
+    if (!tasks_.TryPush(task)) {
+        RecordRejected();
+        return nullopt;
+    }
+    WakeWorker();
     return result;
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return no_results_requests_;
+    return static_cast<int>(GetStats().no_result_requests);
 }
 
-void RequestQueue::AddRequest(int results_num) {
-    ++current_time_;
-    
-    while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-        if (0 == requests_.front().results) {
-            --no_results_requests_;
+RequestQueueStats RequestQueue::GetStats() const {
+    RequestQueueStats stats;
+    const int64_t now = Clock::now().time_since_epoch() / options_.bucket_duration;
+    const int64_t oldest = now - static_cast<int64_t>(options_.bucket_count) + 1;
+    uint64_t latency_sum_ns = 0;
+    for (size_t i = 0; i < options_.bucket_count; ++i) {
+        const WindowBucket& bucket = buckets_[i];
+        const int64_t epoch = bucket.epoch.load(memory_order_acquire);
+        if (epoch < oldest || epoch > now) {
+            continue;
         }
-        requests_.pop_front();
+        stats.requests += bucket.requests.load(memory_order_relaxed);
+        stats.no_result_requests += bucket.no_result_requests.load(memory_order_relaxed);
+        stats.rejected_requests += bucket.rejected_requests.load(memory_order_relaxed);
+        latency_sum_ns += bucket.latency_sum_ns.load(memory_order_relaxed);
+        stats.max_latency_ns = max(stats.max_latency_ns, bucket.latency_max_ns.load(memory_order_relaxed));
     }
+    stats.mean_latency_ns = stats.requests == 0 ? 0.0 : static_cast<double>(latency_sum_ns) / stats.requests;
+    stats.queue_depth = tasks_.Size();
+    stats.parked_workers = parked_workers_.load(memory_order_relaxed);
+    stats.worker_parks = worker_parks_.load(memory_order_relaxed);
+    return stats;
+}
+
+void RequestQueue::RunWorker() {
+    vector<Task> batch;
+    batch.reserve(options_.batch_size);
+    // Moved from after every pop, so that popping does not create and abandon a
+    // promise each time.
+    Task task;
+    int idle_rounds = 0;
+    for (;;) {
+        while (batch.size() < options_.batch_size && tasks_.TryPop(task)) {
+            batch.push_back(move(task));
+        }
+        if (batch.empty()) {
+            // Queued tasks are drained before the worker stops.
+            if (stopping_.load(memory_order_acquire) && tasks_.Size() == 0) {
+                return;
+            }
+            // A short spin catches back-to-back requests; then the worker sleeps.
+            if (idle_rounds < 64) {
+                ++idle_rounds;
+                this_thread::yield();
+            }
+            else {
+                ParkWorker();
+                idle_rounds = 0;
+            }
+            continue;
+        }
+        idle_rounds = 0;
+
+        for (Task& current : batch) {
+            try {
+                auto result = search_server_.FindTopDocuments(current.raw_query, current.status);
+                RecordRequest(result.size(), current.enqueued);
+                current.result.set_value(move(result));
+            }
+            catch (...) {
+                current.result.set_exception(current_exception());
+            }
+        }
+        batch.clear();
+    }
+}
+
+// The parked count and the queue are each written before the other is read, with a
+// full fence in between on both sides: either the producer sees the parked worker
+// and notifies it, or the worker sees the task and does not sleep.
+void RequestQueue::ParkWorker() {
+    unique_lock lock(idle_mutex_);
+    parked_workers_.fetch_add(1, memory_order_relaxed);
+    worker_parks_.fetch_add(1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    work_available_.wait(lock, [this] {
+        return tasks_.Size() > 0 || stopping_.load(memory_order_acquire);
+    });
+    parked_workers_.fetch_sub(1, memory_order_relaxed);
+}
 
-    requests_.push_back({ current_time_, results_num });
+void RequestQueue::WakeWorker() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (parked_workers_.load(memory_order_relaxed) > 0) {
+        // Taken so that the notification cannot fall between the worker's check and its wait.
+        lock_guard lock(idle_mutex_);
+        work_available_.notify_one();
+    }
+}
+
+void RequestQueue::RecordArrival(string_view raw_query, DocumentStatus status) {
+    if (options_.recorder != nullptr) {
+        options_.recorder->Record(raw_query, status);
+    }
+}
+
+void RequestQueue::RecordRequest(size_t results_num, Clock::time_point start) {
+    const auto latency_ns = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+    WindowBucket& bucket = GetCurrentBucket();
+    bucket.requests.fetch_add(1, memory_order_relaxed);
     if (0 == results_num) {
-        ++no_results_requests_;
+        bucket.no_result_requests.fetch_add(1, memory_order_relaxed);
+    }
+    bucket.latency_sum_ns.fetch_add(latency_ns, memory_order_relaxed);
+    uint64_t current_max = bucket.latency_max_ns.load(memory_order_relaxed);
+    while (latency_ns > current_max
+        && !bucket.latency_max_ns.compare_exchange_weak(current_max, latency_ns, memory_order_relaxed)) {
     }
-}
\ No newline at end of file
+}
+
+void RequestQueue::RecordRejected() {
+    GetCurrentBucket().rejected_requests.fetch_add(1, memory_order_relaxed);
+}
+
+RequestQueue::WindowBucket& RequestQueue::GetCurrentBucket() {
+    const int64_t now = Clock::now().time_since_epoch() / options_.bucket_duration;
+    WindowBucket& bucket = buckets_[static_cast<size_t>(now) % options_.bucket_count];
+    int64_t epoch = bucket.epoch.load(memory_order_acquire);
+    if (epoch < now && bucket.epoch.compare_exchange_strong(epoch, now, memory_order_acq_rel)) {
+        bucket.requests.store(0, memory_order_relaxed);
+        bucket.no_result_requests.store(0, memory_order_relaxed);
+        bucket.rejected_requests.store(0, memory_order_relaxed);
+        bucket.latency_sum_ns.store(0, memory_order_relaxed);
+        bucket.latency_max_ns.store(0, memory_order_relaxed);
+    }
+    return bucket;
+}
@@ -2,42 +2,119 @@
 
 #include <vector>
 #include <string>
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include "document.h"
 #include "search_server.h"
+#include "mpmc_queue.h"
 
 using namespace std;
 
+class WorkloadRecorder;
+
+struct RequestQueueOptions {
+    size_t capacity = 1024;
+    size_t workers = max(1u, thread::hardware_concurrency());
+    size_t batch_size = 16;
+    // Statistics cover bucket_count buckets of bucket_duration each: a day by default.
+    chrono::steady_clock::duration bucket_duration = chrono::minutes(1);
+    size_t bucket_count = 1440;
+    // Captures every request on arrival, rejected ones included. Requests with a
+    // custom predicate are recorded as ACTUAL: the predicate cannot be stored.
+    WorkloadRecorder* recorder = nullptr;
+};
+
+struct RequestQueueStats {
+    uint64_t requests = 0;
+    uint64_t no_result_requests = 0;
+    uint64_t rejected_requests = 0;
+    double mean_latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+    size_t queue_depth = 0;
+    // Not windowed: workers sleeping right now, and how many times any worker has gone to sleep.
+    size_t parked_workers = 0;
+    uint64_t worker_parks = 0;
+};
+
+// Front-end scheduler for a SearchServer. Producers on any thread submit queries
+// into a bounded lock-free queue; worker threads drain it in micro-batches and
+// sleep on a condition variable while it stays empty.
+// AddFindRequest still runs the query inline on the calling thread.
+// The server must not be modified while the queue is alive.
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    explicit RequestQueue(const SearchServer& search_server, RequestQueueOptions options = {});
+    ~RequestQueue();
+
+    RequestQueue(const RequestQueue&) = delete;
+    RequestQueue& operator=(const RequestQueue&) = delete;
 
     template <typename DocumentPredicate>
     vector<Document> AddFindRequest(const string& raw_query, DocumentPredicate document_predicate) {
+        RecordArrival(raw_query, DocumentStatus::ACTUAL);
+        const auto start = Clock::now();
         const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-        AddRequest(result.size());
+        RecordRequest(result.size(), start);
         return result;
     }
 
     vector<Document> AddFindRequest(const string& raw_query, DocumentStatus status);
     vector<Document> AddFindRequest(const string& raw_query);
+
+    // Waits for a free slot while the queue is full (backpressure).
+    future<vector<Document>> Submit(string raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+    // Returns nothing and counts the request as rejected when the queue is full (load shedding).
+    optional<future<vector<Document>>> TrySubmit(string raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
     int GetNoResultRequests() const;
+    RequestQueueStats GetStats() const;
 
 private:
-    struct QueryResult {
-        uint64_t timestamp;
-        int results;
+    using Clock = chrono::steady_clock;
+
+    struct Task {
+        string raw_query;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        promise<vector<Document>> result;
+        Clock::time_point enqueued;
     };
 
-    deque<QueryResult> requests_;
+    // Counters of one time bucket. A bucket is reused once its epoch leaves the
+    // window; increments racing with the reset may be lost, which is fine for statistics.
+    struct WindowBucket {
+        atomic<int64_t> epoch = -1;
+        atomic<uint64_t> requests = 0;
+        atomic<uint64_t> no_result_requests = 0;
+        atomic<uint64_t> rejected_requests = 0;
+        atomic<uint64_t> latency_sum_ns = 0;
+        atomic<uint64_t> latency_max_ns = 0;
+    };
 
     const SearchServer& search_server_;
+    const RequestQueueOptions options_;
+    MpmcQueue<Task> tasks_;
+    unique_ptr<WindowBucket[]> buckets_;
+    atomic<bool> stopping_ = false;
+    // Producers take the mutex to wake a worker only while some are parked.
+    mutex idle_mutex_;
+    condition_variable work_available_;
+    atomic<size_t> parked_workers_ = 0;
+    atomic<uint64_t> worker_parks_ = 0;
+    vector<thread> workers_;
 
-    int no_results_requests_;
-
-    uint64_t current_time_;
-
-    const static int min_in_day_ = 1440;
-
-    void AddRequest(int results_num);
+    optional<Task> MakeTask(string raw_query, DocumentStatus status, future<vector<Document>>& result) const;
+    void RunWorker();
+    // Waits until the queue is non-empty or the queue is stopping.
+    void ParkWorker();
+    void WakeWorker();
+    void RecordArrival(string_view raw_query, DocumentStatus status);
+    void RecordRequest(size_t results_num, Clock::time_point start);
+    void RecordRejected();
+    WindowBucket& GetCurrentBucket();
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+enum class Scoring {
+    TF_IDF,
+    BM25,
+};
+
+// A scorer turns the postings of one query term into relevance contributions.
+// ScorePostings is a plain loop over the contiguous columns of a PostingList with
+// no branches or lookups, so the compiler can vectorize it; everything that depends
+// on the query or the collection is folded into constants before the loop.
+// term_freqs are normalized by document length, as stored in the index.
+
+// Default: term frequency times log(N / df).
+struct TfIdfScorer {
+    double ComputeInverseDocumentFreq(size_t document_count, size_t document_freq) const {
+        return log(document_count * 1.0 / document_freq);
+    }
+
+    void ScorePostings(const double* term_freqs, const uint32_t*, size_t count,
+        double inverse_document_freq, double* scores) const {
+        for (size_t i = 0; i < count; ++i) {
+            scores[i] = term_freqs[i] * inverse_document_freq;
+        }
+    }
+};
+
+// Okapi BM25. The length norm k1 * (1 - b + b * length / average_length) is an
+// affine function of the document length, so the loop needs two constants, not a
+// per-document table that would change with every added document.
+struct Bm25Scorer {
+    Bm25Scorer(double k1, double b, double average_document_length)
+        : k1_(k1)
+        , norm_base_(k1 * (1 - b))
+        , norm_per_word_(average_document_length > 0 ? k1 * b / average_document_length : 0) {
+    }
+
+    // The non-negative variant: words found in most documents still count a little.
+    double ComputeInverseDocumentFreq(size_t document_count, size_t document_freq) const {
+        return log(1 + (static_cast<double>(document_count) - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    void ScorePostings(const double* term_freqs, const uint32_t* document_lengths, size_t count,
+        double inverse_document_freq, double* scores) const {
+        const double numerator = inverse_document_freq * (k1_ + 1);
+        for (size_t i = 0; i < count; ++i) {
+            const double length = document_lengths[i];
+            const double occurrences = term_freqs[i] * length;
+            scores[i] = numerator * occurrences / (occurrences + norm_base_ + norm_per_word_ * length);
+        }
+    }
+
+private:
+    double k1_;
+    double norm_base_;
+    double norm_per_word_;
+};
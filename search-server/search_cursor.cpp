@@ -0,0 +1,53 @@
+#include "search_cursor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "search_server.h"
+
+SearchCursor::SearchCursor(vector<Document> candidates, size_t page_size)
+    : candidates_(move(candidates))
+    , page_size_(page_size) {
+    if (page_size == 0) {
+        throw invalid_argument("Page size must be positive"s);
+    }
+}
+
+vector<Document> SearchCursor::NextPage() {
+    return GetPage(next_page_);
+}
+
+vector<Document> SearchCursor::GetPage(size_t page_index) {
+    // Compared before multiplying: the product may overflow for pages past the end.
+    const size_t page_count = GetPageCount();
+    const size_t first = page_index < page_count ? page_index * page_size_ : candidates_.size();
+    const size_t last = first + min(page_size_, candidates_.size() - first);
+    SortPrefix(last);
+    next_page_ = min(page_index, page_count) + 1;
+    return { candidates_.begin() + first, candidates_.begin() + last };
+}
+
+bool SearchCursor::HasMore() const {
+    return next_page_ < GetPageCount();
+}
+
+size_t SearchCursor::GetPageSize() const {
+    return page_size_;
+}
+
+size_t SearchCursor::GetPageCount() const {
+    return candidates_.size() / page_size_ + (candidates_.size() % page_size_ != 0 ? 1 : 0);
+}
+
+size_t SearchCursor::GetResultCount() const {
+    return candidates_.size();
+}
+
+void SearchCursor::SortPrefix(size_t count) {
+    if (count <= sorted_) {
+        return;
+    }
+    partial_sort(candidates_.begin() + sorted_, candidates_.begin() + count, candidates_.end(),
+        SearchServer::IsMoreRelevant);
+    sorted_ = count;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "document.h"
+
+using namespace std;
+
+// Paged view over the scored results of one query. The documents are scored once
+// when the cursor is opened; each page then orders only as many results as it
+// needs, so page N costs a partial selection of the top (N + 1) * page_size
+// instead of a full sort. Earlier pages stay ordered and are not sorted again.
+// The cursor holds a snapshot of the scores and does not see later index changes.
+class SearchCursor {
+public:
+    SearchCursor() = default;
+    SearchCursor(vector<Document> candidates, size_t page_size);
+
+    vector<Document> NextPage();
+    vector<Document> GetPage(size_t page_index);
+
+    bool HasMore() const;
+    size_t GetPageSize() const;
+    size_t GetPageCount() const;
+    size_t GetResultCount() const;
+
+private:
+    // candidates_[0, sorted_) is already in final order; the rest is unordered.
+    vector<Document> candidates_;
+    size_t sorted_ = 0;
+    size_t next_page_ = 0;
+    size_t page_size_ = 1;
+
+    void SortPrefix(size_t count);
+};
@@ -1,56 +1,283 @@
 #include "search_server.h"
 
-SearchServer::SearchServer(const string& stop_words)
-: SearchServer(SplitIntoWords(string_view(stop_words))) {
+#include "mutation_log.h"
+
+SearchServer::SearchServer(const string& stop_words, SearchServerOptions options)
+: SearchServer(SplitIntoWords(string_view(stop_words)), options) {
 
 }
 
-SearchServer::SearchServer(string_view& stop_words)
-    : SearchServer(SplitIntoWords(stop_words)) {
+SearchServer::SearchServer(string_view& stop_words, SearchServerOptions options)
+    : SearchServer(SplitIntoWords(stop_words), options) {
 
 }
 
 void SearchServer::AddDocument(int document_id, const string_view& document,
     DocumentStatus status, const vector<int>& ratings) {
+    METRICS_TIMER(Timer::ADD_DOCUMENT);
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
 
-    all_words_.emplace_back(document);
+    // The text joins document_texts_ once it has been indexed: on an invalid word
+    // nothing is left behind.
+    pmr::map<int, pmr::string> text(&text_memory_);
+    IndexDocument(document_id, text.emplace(document_id, document).first->second, status, ratings);
+    document_texts_.insert(text.extract(document_id));
+    if (mutation_log_ != nullptr) {
+        mutation_log_->AppendAdd(document_id, document, status, ratings);
+    }
+    CheckMemoryBudget();
+}
+
+void SearchServer::AddExternalDocument(int document_id, string_view document,
+    DocumentStatus status, const vector<int>& ratings) {
+    METRICS_TIMER(Timer::ADD_DOCUMENT);
+    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+        throw invalid_argument("Invalid document_id"s);
+    }
 
-    const auto words = SplitIntoWordsNoStop(all_words_.back());
+    IndexDocument(document_id, document, status, ratings);
+    if (mutation_log_ != nullptr) {
+        mutation_log_->AppendAdd(document_id, document, status, ratings);
+    }
+    CheckMemoryBudget();
+}
+
+pmr::memory_resource* SearchServer::SelectUpstream(pmr::memory_resource* pool, const SearchServerOptions& options) {
+    if (options.pooled_allocation) {
+        return pool;
+    }
+    return &heap_memory_;
+}
+
+void SearchServer::SetMutationLog(MutationLog* mutation_log) {
+    mutation_log_ = mutation_log;
+}
+
+void SearchServer::KeepAlive(shared_ptr<const void> text_owner) {
+    text_owners_.push_back(move(text_owner));
+}
+
+void SearchServer::SetSharedFrequencies(const DocumentFrequencies* frequencies) {
+    shared_frequencies_ = frequencies;
+}
+
+void SearchServer::IndexDocument(int document_id, string_view document,
+    DocumentStatus status, const vector<int>& ratings) {
+    const auto words = SplitIntoWordsNoStop(document);
 
     const double inv_word_count = 1.0 / words.size();
+    const uint32_t length = static_cast<uint32_t>(words.size());
     for (const string_view& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+        const auto postings = GetOrAddPostings(word);
+        postings->second.Add(document_id, inv_word_count, length);
+        document_to_word_freqs_[document_id][postings->first] += inv_word_count;
+    }
+
+    for (const auto& [word, _] : document_to_word_freqs_[document_id]) {
+        OnPostingAdded(word, document_id);
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+    posting_count_ += document_to_word_freqs_[document_id].size();
+    status_to_documents_[static_cast<size_t>(status)].Add(document_id);
+    IndexPositions(document_id, document);
+
+    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, document, length });
+    total_document_length_ += length;
     document_ids_.insert(document_id);
 }
 
+void SearchServer::UpdateDocument(int document_id, const string_view& document,
+    DocumentStatus status, const vector<int>& ratings) {
+    METRICS_TIMER(Timer::UPDATE_DOCUMENT);
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    DocumentData& document_data = it->second;
+    const int rating = ComputeAverageRating(ratings);
+
+    if (document != document_data.text) {
+        pmr::map<int, pmr::string> text(&text_memory_);
+        ReindexDocument(document_id, text.emplace(document_id, document).first->second, document_data);
+        document_texts_.erase(document_id);
+        document_texts_.insert(text.extract(document_id));
+    }
+    if (status != document_data.status) {
+        status_to_documents_[static_cast<size_t>(document_data.status)].Remove(document_id);
+        status_to_documents_[static_cast<size_t>(status)].Add(document_id);
+        document_data.status = status;
+    }
+    document_data.rating = rating;
+
+    if (mutation_log_ != nullptr) {
+        mutation_log_->AppendAdd(document_id, document, status, ratings);
+    }
+    CheckMemoryBudget();
+}
+
+void SearchServer::ReindexDocument(int document_id, string_view document, DocumentData& document_data) {
+    const auto words = SplitIntoWordsNoStop(document);
+
+    const double inv_word_count = 1.0 / words.size();
+    const uint32_t length = static_cast<uint32_t>(words.size());
+    map<string_view, double> new_word_freqs;
+    for (const string_view& word : words) {
+        new_word_freqs[word] += inv_word_count;
+    }
+
+    auto& word_freqs = document_to_word_freqs_.at(document_id);
+    if (options_.positional_index) {
+        vector<string_view> old_words;
+        for (const auto& [word, _] : word_freqs) {
+            old_words.push_back(word);
+        }
+        positional_index_.RemoveDocument(document_id, old_words);
+    }
+
+    // Both maps are sorted by word: one merge pass sorts the words into removed,
+    // changed and added ones. Frequencies are summed the same way as on indexing,
+    // so an unchanged word compares equal.
+    auto new_it = new_word_freqs.begin();
+    for (auto old_it = word_freqs.begin(); old_it != word_freqs.end();) {
+        while (new_it != new_word_freqs.end() && new_it->first < old_it->first) {
+            const auto postings = GetOrAddPostings(new_it->first);
+            postings->second.Add(document_id, new_it->second, length);
+            word_freqs.emplace_hint(old_it, postings->first, new_it->second);
+            OnPostingAdded(postings->first, document_id);
+            ++posting_count_;
+            ++new_it;
+        }
+        if (new_it == new_word_freqs.end() || old_it->first < new_it->first) {
+            RemovePosting(old_it->first, document_id);
+            old_it = word_freqs.erase(old_it);
+            --posting_count_;
+            continue;
+        }
+        if (new_it->second != old_it->second || length != document_data.length) {
+            word_to_document_freqs_.at(old_it->first).Update(document_id, new_it->second, length);
+            old_it->second = new_it->second;
+        }
+        ++old_it;
+        ++new_it;
+    }
+    for (; new_it != new_word_freqs.end(); ++new_it) {
+        const auto postings = GetOrAddPostings(new_it->first);
+        postings->second.Add(document_id, new_it->second, length);
+        word_freqs.emplace_hint(word_freqs.end(), postings->first, new_it->second);
+        OnPostingAdded(postings->first, document_id);
+        ++posting_count_;
+    }
+
+    IndexPositions(document_id, document);
+    total_document_length_ = total_document_length_ - document_data.length + length;
+    document_data.text = document;
+    document_data.length = length;
+}
+
+void SearchServer::IndexPositions(int document_id, string_view document) {
+    if (!options_.positional_index) {
+        return;
+    }
+    // Keys of the positional index view index_words_, like all other index keys.
+    const auto& word_freqs = document_to_word_freqs_.at(document_id);
+    vector<string_view> indexed_words;
+    vector<uint32_t> positions;
+    uint32_t position = 0;
+    for (const string_view& word : SplitIntoWords(document)) {
+        if (!IsStopWord(word)) {
+            indexed_words.push_back(word_freqs.find(word)->first);
+            positions.push_back(position);
+        }
+        ++position;
+    }
+    positional_index_.AddDocument(document_id, indexed_words, positions);
+}
+
+pmr::map<string_view, PostingList>::iterator SearchServer::GetOrAddPostings(string_view word) {
+    auto it = word_to_document_freqs_.lower_bound(word);
+    if (it == word_to_document_freqs_.end() || it->first != word) {
+        it = word_to_document_freqs_.try_emplace(it, *index_words_.emplace(word).first);
+    }
+    return it;
+}
+
+void SearchServer::OnPostingAdded(string_view word, int document_id) {
+    const auto& postings = word_to_document_freqs_.at(word);
+    if (postings.size() == 1 && options_.max_typo_distance > 0) {
+        typo_index_.AddTerm(word);
+    }
+    if (postings.size() < options_.dense_word_min_documents) {
+        return;
+    }
+    const auto [it, inserted] = word_to_document_set_.try_emplace(word);
+    if (inserted) {
+        for (const auto& [id, _] : postings) {
+            it->second.Add(id);
+        }
+    }
+    else {
+        it->second.Add(document_id);
+    }
+}
+
+void SearchServer::RemovePosting(string_view word, int document_id) {
+    word_to_document_freqs_.at(word).erase(document_id);
+    OnPostingRemoved(word, document_id);
+}
+
+void SearchServer::OnPostingRemoved(string_view word, int document_id) {
+    if (const auto it = word_to_document_set_.find(word); it != word_to_document_set_.end()) {
+        const size_t document_count = word_to_document_freqs_.at(word).size();
+        if (document_count < options_.dense_word_min_documents || document_count == 0) {
+            word_to_document_set_.erase(it);
+        }
+        else {
+            it->second.Remove(document_id);
+        }
+    }
+    if (word_to_document_freqs_.at(word).size() == 0) {
+        if (options_.max_typo_distance > 0) {
+            typo_index_.RemoveTerm(word);
+        }
+        word_to_document_freqs_.erase(word);
+        // Last: word views the string released here.
+        index_words_.erase(index_words_.find(word));
+    }
+}
+
 vector<Document> SearchServer::FindTopDocuments(
     const string_view& raw_query, DocumentStatus status) const {
     return FindTopDocuments(execution::seq,
-        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        });
+        raw_query, StatusPredicate{ status });
+}
+
+vector<Document> SearchServer::FindTopDocuments(
+    const string_view& raw_query, DocumentStatus status, QueryProfile& profile) const {
+    return FindTopDocuments(
+        raw_query, StatusPredicate{ status }, profile);
+}
+
+void SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status,
+    QueryContext& context, vector<Document>& results) const {
+    FindTopDocuments(raw_query, StatusPredicate{ status }, context, results);
+}
+
+void SearchServer::FindTopDocuments(const string_view& raw_query,
+    QueryContext& context, vector<Document>& results) const {
+    FindTopDocuments(raw_query, DocumentStatus::ACTUAL, context, results);
 }
 
 vector<Document> SearchServer::FindTopDocuments(const execution::parallel_policy&,
     const string_view& raw_query, DocumentStatus status) const {
     return FindTopDocuments(execution::par,
-        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        });
+        raw_query, StatusPredicate{ status });
 }
 
 vector<Document> SearchServer::FindTopDocuments(const execution::sequenced_policy&,
     const string_view& raw_query, DocumentStatus status) const {
     return FindTopDocuments(execution::seq,
-        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        });
+        raw_query, StatusPredicate{ status });
 }
 
 vector<Document> SearchServer::FindTopDocuments(
@@ -68,20 +295,35 @@ vector<Document> SearchServer::FindTopDocuments(const execution::sequenced_polic
     return FindTopDocuments(execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
+SearchCursor SearchServer::OpenSearchCursor(const string_view& raw_query, DocumentStatus status, size_t page_size) const {
+    return OpenSearchCursor(
+        raw_query, StatusPredicate{ status }, page_size);
+}
+
+SearchCursor SearchServer::OpenSearchCursor(const string_view& raw_query, size_t page_size) const {
+    return OpenSearchCursor(raw_query, DocumentStatus::ACTUAL, page_size);
+}
+
+SearchServer::QueryContext::QueryContext()
+    : memory_(pmr::pool_options{ 0, 1 << 16 })
+    , excluded_(&memory_)
+    , document_to_relevance_(&memory_) {
+}
+
 int SearchServer::GetDocumentCount() const {
     return static_cast<int>(documents_.size());
 }
 
-set<int>::const_iterator SearchServer::begin() const {
+pmr::set<int>::const_iterator SearchServer::begin() const {
     return document_ids_.begin();
 }
 
-set<int>::const_iterator SearchServer::end() const {
+pmr::set<int>::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const map<string_view, double> empty_map;
+const pmr::map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
+    static const pmr::map<string_view, double> empty_map;
     
     if (document_to_word_freqs_.count(document_id) == 0) {
         return empty_map;
@@ -90,22 +332,41 @@ const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id
     return document_to_word_freqs_.at(document_id);
 }
 
+size_t SearchServer::GetDocumentLength(int document_id) const {
+    const auto it = documents_.find(document_id);
+    return it == documents_.end() ? 0 : it->second.length;
+}
+
 void SearchServer::RemoveDocument(int document_id) {
+    METRICS_TIMER(Timer::REMOVE_DOCUMENT);
     if (document_to_word_freqs_.count(document_id) == 0) {
         return;
     }
 
-    for (auto& [word, _] : document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
-        if (word_to_document_freqs_.at(word).size() == 0) {
-            word_to_document_freqs_.erase(word);
+    // Positions go first: removing the last posting of a word releases its key.
+    if (options_.positional_index) {
+        vector<string_view> words;
+        for (const auto& [word, _] : document_to_word_freqs_.at(document_id)) {
+            words.push_back(word);
         }
+        positional_index_.RemoveDocument(document_id, words);
     }
-    
+
+    for (auto& [word, _] : document_to_word_freqs_.at(document_id)) {
+        RemovePosting(word, document_id);
+    }
+
+    posting_count_ -= document_to_word_freqs_.at(document_id).size();
+    total_document_length_ -= documents_.at(document_id).length;
+    status_to_documents_[static_cast<size_t>(documents_.at(document_id).status)].Remove(document_id);
     document_to_word_freqs_.erase(document_id);
     documents_.erase(document_id);
+    document_texts_.erase(document_id);
 
     document_ids_.erase(document_id);
+    if (mutation_log_ != nullptr) {
+        mutation_log_->AppendRemove(document_id);
+    }
 }
 
 void SearchServer::RemoveDocument(const execution::sequenced_policy&, int document_id){
@@ -113,6 +374,7 @@ void SearchServer::RemoveDocument(const execution::sequenced_policy&, int docume
 }
 
 void SearchServer::RemoveDocument(const execution::parallel_policy&, int document_id) {
+    METRICS_TIMER(Timer::REMOVE_DOCUMENT);
     if (document_to_word_freqs_.count(document_id) == 0) {
         return;
     }
@@ -133,14 +395,31 @@ void SearchServer::RemoveDocument(const execution::parallel_policy&, int documen
         std::execution::par,
         words.begin(), words.end(),
         [&](const auto& word) {
-            word_to_document_freqs_.at(static_cast<std::string>(word)).erase(document_id);
+            // Erasing from a posting list never releases memory, so the pool is not
+            // used concurrently.
+            word_to_document_freqs_.at(word).erase(document_id);
         }
     );
+    if (options_.positional_index) {
+        positional_index_.RemoveDocument(document_id, words);
+    }
+    // The rest releases memory (set chunks, emptied lists, typo index entries, word
+    // keys), so it runs sequentially.
+    for (const string_view word : words) {
+        OnPostingRemoved(word, document_id);
+    }
 
+    posting_count_ -= document_to_word_freqs_.at(document_id).size();
+    total_document_length_ -= documents_.at(document_id).length;
+    status_to_documents_[static_cast<size_t>(documents_.at(document_id).status)].Remove(document_id);
     document_to_word_freqs_.erase(document_id);
 
     documents_.erase(document_id);
+    document_texts_.erase(document_id);
     document_ids_.erase(document_id);
+    if (mutation_log_ != nullptr) {
+        mutation_log_->AppendRemove(document_id);
+    }
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
@@ -148,17 +427,35 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const str
     const Query query = ParseQuery(raw_query, true);
 
     vector<string_view> matched_words;
+    const DocumentStatus status = MatchQuery(query, document_id, matched_words);
+    return { matched_words, status };
+}
+
+DocumentStatus SearchServer::MatchDocument(const string_view& raw_query, int document_id,
+    QueryContext& context, vector<string_view>& matched_words) const {
+    ParseQuery(raw_query, true, context.query_, context.words_);
+    return MatchQuery(context.query_, document_id, matched_words);
+}
+
+DocumentStatus SearchServer::MatchQuery(const Query& query, int document_id, vector<string_view>& matched_words) const {
+    const DocumentStatus status = documents_.at(document_id).status;
+    matched_words.clear();
 
     for (const string_view& word : query.minus_words) {
         if (word_to_document_freqs_.count(word) == 0) {
             continue;
         }
         if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.clear();
-            return { matched_words, documents_.at(document_id).status };
+            return status;
         }
     }
 
+    if (!ContainsRequiredWords(query, document_id) || !MatchesPhrases(document_id, query.phrases)
+        || !MatchPrefixes(query, document_id, matched_words)) {
+        matched_words.clear();
+        return status;
+    }
+
     for (const string_view& word : query.plus_words) {
         if (word_to_document_freqs_.count(word) == 0) {
             continue;
@@ -167,7 +464,67 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const str
             matched_words.push_back(word);
         }
     }
+    MatchTypos(query, document_id, matched_words);
 
+    if (!query.plus_prefixes.empty() || options_.max_typo_distance > 0) {
+        sort(matched_words.begin(), matched_words.end());
+        matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    }
+
+    return status;
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view& raw_query, int document_id,
+    QueryProfile& profile) const {
+    using Clock = chrono::steady_clock;
+    profile = QueryProfile{};
+
+    const auto parse_start = Clock::now();
+    const Query query = ParseQuery(raw_query, true);
+    const auto match_start = Clock::now();
+
+    const auto profile_term = [&](string_view word, bool is_minus) {
+        TermProfile term{ string(word), is_minus };
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end()) {
+            term.postings = it->second.size();
+            term.inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+            const size_t hit = it->second.count(document_id);
+            term.kept = is_minus ? term.postings - hit : hit;
+            term.rejected = term.postings - term.kept;
+        }
+        profile.terms.push_back(term);
+        return (is_minus ? term.rejected : term.kept) > 0;
+    };
+
+    vector<string_view> matched_words;
+    for (const string_view& word : query.minus_words) {
+        if (profile_term(word, true)) {
+            profile.removed_by_minus_words = 1;
+        }
+    }
+    vector<string_view> prefix_matches;
+    if (!MatchPrefixes(query, document_id, prefix_matches)) {
+        profile.removed_by_minus_words = 1;
+    }
+    MatchTypos(query, document_id, prefix_matches);
+    const bool phrases_matched = ContainsRequiredWords(query, document_id) && MatchesPhrases(document_id, query.phrases);
+    for (const string_view& word : query.plus_words) {
+        if (profile_term(word, false) && profile.removed_by_minus_words == 0 && phrases_matched) {
+            matched_words.push_back(word);
+        }
+    }
+    if (profile.removed_by_minus_words == 0 && phrases_matched) {
+        matched_words.insert(matched_words.end(), prefix_matches.begin(), prefix_matches.end());
+        sort(matched_words.begin(), matched_words.end());
+        matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    }
+    const auto match_end = Clock::now();
+
+    profile.parse_time = match_start - parse_start;
+    profile.scoring_time = match_end - match_start;
+    profile.candidates = 1;
+    profile.results = matched_words.size();
     return { matched_words, documents_.at(document_id).status };
 }
 
@@ -189,8 +546,10 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const exe
                     word_to_document_freqs_.at(word).count(document_id) != 0;
             });
 
-    if (minus_detected) {
-        return { {}, documents_.at(document_id).status };
+    vector<string_view> prefix_matches;
+    if (minus_detected || !ContainsRequiredWords(query, document_id) || !MatchesPhrases(document_id, query.phrases)
+        || !MatchPrefixes(query, document_id, prefix_matches)) {
+        return { vector<string_view>{}, documents_.at(document_id).status };
     }
 
     vector<string_view> matched_words(query.plus_words.size());
@@ -206,6 +565,9 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const exe
                 word_to_document_freqs_.at(word).count(document_id) != 0;
         });
 
+    matched_words.insert(matched_words.end(), prefix_matches.begin(), prefix_matches.end());
+    MatchTypos(query, document_id, matched_words);
+
     std::sort(
         execution::par,
         matched_words.begin(),
@@ -215,14 +577,14 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const exe
         std::unique(matched_words.begin(), matched_words.end()),
         matched_words.end());
 
-    if (*matched_words.begin() == ""s) {
+    if (!matched_words.empty() && *matched_words.begin() == ""s) {
         matched_words.erase(matched_words.begin());
     }
     return { matched_words, documents_.at(document_id).status };
 }
 
 bool SearchServer::IsStopWord(const string_view& word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(const string_view& word) {
@@ -255,34 +617,124 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view word) const {
     }
 
     bool is_minus = false;
+    bool is_required = false;
     if (word[0] == '-') {
         is_minus = true;
         word.remove_prefix(1);
     }
+    else if (word[0] == '+') {
+        is_required = true;
+        word.remove_prefix(1);
+    }
 
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    if (word.empty() || word[0] == '-' || word[0] == '+' || !IsValidWord(word)) {
         throw invalid_argument("Query word "s + string{ word } + " is invalid");
     }
-    return { word, is_minus, IsStopWord(word) };
+    return { word, is_minus, IsStopWord(word), is_required };
 }
 
 SearchServer::Query SearchServer::ParseQuery(const string_view& text, bool purge) const {
     Query result;
+    vector<string_view> words;
+    ParseQuery(text, purge, result, words);
+    return result;
+}
 
-    vector<string_view> words = SplitIntoWords(text);
+void SearchServer::ParseQuery(const string_view& text, bool purge, Query& result, vector<string_view>& words) const {
+    for (auto* query_words : { &result.plus_words, &result.minus_words, &result.required_words,
+        &result.plus_prefixes, &result.minus_prefixes }) {
+        query_words->clear();
+    }
+    result.phrases.clear();
 
-    for (const string_view& word : words) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+    SplitIntoWords(text, words);
 
+    optional<Phrase> phrase;
+    uint32_t phrase_offset = 0;
+    for (string_view word : words) {
+        const bool opens_phrase = !word.empty() && word.front() == '"';
+        if (opens_phrase) {
+            if (phrase) {
+                throw invalid_argument("Nested quotes in query"s);
+            }
+            word.remove_prefix(1);
+            phrase.emplace();
+            phrase_offset = 0;
+        }
+        else if (word.size() > 1 && word[0] == '-' && word[1] == '"') {
+            throw invalid_argument("Minus phrases are not supported"s);
+        }
+        else if (word.size() > 1 && word[0] == '+' && word[1] == '"') {
+            throw invalid_argument("Required phrases are not supported"s);
+        }
+        const bool closes_phrase = !word.empty() && word.back() == '"';
+        if (closes_phrase) {
+            if (!phrase) {
+                throw invalid_argument("Unbalanced quotes in query"s);
+            }
+            word.remove_suffix(1);
+        }
+
+        if (!phrase) {
+            const auto query_word = ParseQueryWord(word);
+            if (query_word.data.back() == '*') {
+                const string_view prefix = query_word.data.substr(0, query_word.data.size() - 1);
+                if (prefix.empty()) {
+                    throw invalid_argument("Query prefix is empty"s);
+                }
+                if (query_word.is_required) {
+                    throw invalid_argument("Required prefixes are not supported"s);
+                }
+                (query_word.is_minus ? result.minus_prefixes : result.plus_prefixes).push_back(prefix);
+                continue;
+            }
+            if (!query_word.is_stop) {
+
+                if (query_word.is_minus) {
+                    result.minus_words.push_back(query_word.data);
+                }
+                else {
+                    result.plus_words.push_back(query_word.data);
+                    if (query_word.is_required) {
+                        result.required_words.push_back(query_word.data);
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (!word.empty()) {
+            const auto query_word = ParseQueryWord(word);
             if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+                throw invalid_argument("Minus word "s + string{ word } + " inside a phrase"s);
             }
-            else {
+            if (query_word.is_required) {
+                throw invalid_argument("Required word "s + string{ word } + " inside a phrase"s);
+            }
+            if (!query_word.is_stop) {
+                phrase->words.push_back(query_word.data);
+                phrase->offsets.push_back(phrase_offset);
                 result.plus_words.push_back(query_word.data);
             }
+            ++phrase_offset;
+        }
+        if (closes_phrase) {
+            if (!phrase->words.empty()) {
+                const uint32_t first_offset = phrase->offsets.front();
+                for (uint32_t& offset : phrase->offsets) {
+                    offset -= first_offset;
+                }
+                result.phrases.push_back(move(*phrase));
+            }
+            phrase.reset();
         }
     }
+    if (phrase) {
+        throw invalid_argument("Unbalanced quotes in query"s);
+    }
+    if (options_.conjunctive_queries) {
+        result.required_words = result.plus_words;
+    }
 
     if (purge) {
         std::sort(result.plus_words.begin(), result.plus_words.end());
@@ -295,11 +747,251 @@ SearchServer::Query SearchServer::ParseQuery(const string_view& text, bool purge
         result.plus_words.erase(
             std::unique(result.plus_words.begin(), result.plus_words.end()),
             result.plus_words.end());
+
+        std::sort(result.required_words.begin(), result.required_words.end());
+        result.required_words.erase(
+            std::unique(result.required_words.begin(), result.required_words.end()),
+            result.required_words.end());
+
+        for (auto* prefixes : { &result.plus_prefixes, &result.minus_prefixes }) {
+            std::sort(prefixes->begin(), prefixes->end());
+            prefixes->erase(std::unique(prefixes->begin(), prefixes->end()), prefixes->end());
+        }
     }
+}
 
-    return result;
+bool SearchServer::MatchesPhrases(int document_id, const vector<Phrase>& phrases) const {
+    for (const Phrase& phrase : phrases) {
+        const bool matched = options_.positional_index
+            ? positional_index_.MatchesPhrase(document_id, phrase)
+            : MatchesPhraseByRescan(document_id, phrase);
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SearchServer::MatchesPhraseByRescan(int document_id, const Phrase& phrase) const {
+    const vector<string_view> words = SplitIntoWords(documents_.at(document_id).text);
+    const size_t span = phrase.offsets.back() + 1;
+    for (size_t start = 0; start + span <= words.size(); ++start) {
+        bool matched = true;
+        for (size_t i = 0; i < phrase.words.size() && matched; ++i) {
+            matched = words[start + phrase.offsets[i]] == phrase.words[i];
+        }
+        if (matched) {
+            return true;
+        }
+    }
+    return false;
+}
+
+vector<string_view> SearchServer::ExpandPrefix(string_view prefix) const {
+    vector<string_view> terms;
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+        it != word_to_document_freqs_.end() && terms.size() < options_.max_prefix_expansions
+            && it->first.substr(0, prefix.size()) == prefix;
+        ++it) {
+        // Removal drops emptied lists; never expand to one all the same, the merge
+        // reads the head of every list.
+        if (!it->second.empty()) {
+            terms.push_back(it->first);
+        }
+    }
+    return terms;
+}
+
+PostingList SearchServer::MergePrefixPostings(string_view prefix) const {
+    // Every list with the position of its current head.
+    vector<pair<const PostingList*, size_t>> lists;
+    for (const string_view term : ExpandPrefix(prefix)) {
+        lists.emplace_back(&word_to_document_freqs_.at(term), 0);
+    }
+
+    // K-way merge by document id; the heap holds the current head of every list.
+    const auto head_id = [&lists](size_t list) {
+        return lists[list].first->GetDocumentIds()[lists[list].second];
+    };
+    const auto head_greater = [&head_id](size_t lhs, size_t rhs) {
+        return head_id(lhs) > head_id(rhs);
+    };
+    vector<size_t> heap(lists.size());
+    iota(heap.begin(), heap.end(), 0);
+    make_heap(heap.begin(), heap.end(), head_greater);
+
+    PostingList merged;
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), head_greater);
+        auto& [postings, position] = lists[heap.back()];
+        merged.Add(postings->GetDocumentIds()[position], postings->GetTermFreqs()[position],
+            postings->GetDocumentLengths()[position]);
+        if (++position == postings->size()) {
+            heap.pop_back();
+        }
+        else {
+            push_heap(heap.begin(), heap.end(), head_greater);
+        }
+    }
+    return merged;
+}
+
+// Appends the expansions of plus-prefixes found in the document.
+// Returns false if the document contains an expansion of a minus-prefix.
+bool SearchServer::MatchPrefixes(const Query& query, int document_id, vector<string_view>& matched_words) const {
+    for (const string_view prefix : query.minus_prefixes) {
+        for (const string_view term : ExpandPrefix(prefix)) {
+            if (word_to_document_freqs_.at(term).count(document_id)) {
+                return false;
+            }
+        }
+    }
+    for (const string_view prefix : query.plus_prefixes) {
+        for (const string_view term : ExpandPrefix(prefix)) {
+            if (word_to_document_freqs_.at(term).count(document_id)) {
+                matched_words.push_back(term);
+            }
+        }
+    }
+    return true;
+}
+
+void SearchServer::CollectExcludedDocuments(const Query& query, DocumentSet& excluded) const {
+    excluded.Clear();
+    const auto exclude_word = [&](string_view word) {
+        if (const auto it = word_to_document_set_.find(word); it != word_to_document_set_.end()) {
+            excluded.UnionWith(it->second);
+        }
+        else if (const auto postings = word_to_document_freqs_.find(word); postings != word_to_document_freqs_.end()) {
+            for (const auto& [document_id, _] : postings->second) {
+                excluded.Add(document_id);
+            }
+        }
+    };
+    for (const string_view word : query.minus_words) {
+        exclude_word(word);
+    }
+    for (const string_view prefix : query.minus_prefixes) {
+        for (const string_view term : ExpandPrefix(prefix)) {
+            exclude_word(term);
+        }
+    }
+}
+
+void SearchServer::CollectCandidates(const Query& query, vector<int>& candidates) const {
+    candidates.clear();
+    vector<const PostingList*> lists;
+    lists.reserve(query.required_words.size());
+    for (const string_view word : query.required_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end()) {
+            return;
+        }
+        lists.push_back(&it->second);
+    }
+    // Shortest first: it bounds the candidates, and every later list is only probed.
+    sort(lists.begin(), lists.end(), [](const PostingList* lhs, const PostingList* rhs) {
+        return lhs->size() < rhs->size();
+    });
+    candidates.assign(lists.front()->GetDocumentIds(), lists.front()->GetDocumentIds() + lists.front()->size());
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+        lists[i]->IntersectWith(candidates);
+    }
+}
+
+bool SearchServer::ContainsRequiredWords(const Query& query, int document_id) const {
+    return all_of(query.required_words.begin(), query.required_words.end(), [&](string_view word) {
+        const auto it = word_to_document_freqs_.find(word);
+        return it != word_to_document_freqs_.end() && it->second.count(document_id) != 0;
+    });
+}
+
+MemoryStats SearchServer::GetMemoryStats() const {
+    const auto usage = [](const TrackingMemoryResource& memory, size_t objects) {
+        return MemoryUsage{ memory.GetBytes(), memory.GetAllocationCount(), objects };
+    };
+    MemoryStats stats;
+    stats.document_text = usage(text_memory_, document_texts_.size());
+    stats.inverted_index = usage(inverted_index_memory_, posting_count_);
+    stats.forward_index = usage(forward_index_memory_, posting_count_);
+    stats.documents = usage(documents_memory_, documents_.size());
+    stats.stop_words = usage(stop_words_memory_, stop_words_.size());
+    stats.positional_index = usage(positional_index_memory_, positional_index_.GetListCount());
+    stats.typo_index = usage(typo_index_memory_, typo_index_.GetTermCount());
+    // Pool slack and heap headers: whatever the heap holds beyond the requests.
+    const size_t requested = stats.GetTotalBytes();
+    const size_t footprint = heap_memory_.GetFootprint();
+    stats.allocator_overhead = footprint > requested ? footprint - requested : 0;
+    stats.heap_allocations = heap_memory_.GetAllocationCount();
+    return stats;
+}
+
+void SearchServer::CheckMemoryBudget() {
+    if (options_.memory_budget == 0) {
+        return;
+    }
+    const MemoryStats stats = GetMemoryStats();
+    const bool over_budget = stats.GetTotalBytes() > options_.memory_budget;
+    if (over_budget && !over_memory_budget_) {
+        over_memory_budget_ = true;
+        if (options_.on_memory_budget_exceeded) {
+            options_.on_memory_budget_exceeded(stats);
+        }
+        else {
+            cerr << "Search server memory budget exceeded: "s << stats.GetTotalBytes()
+                << " of "s << options_.memory_budget << " bytes"s << endl;
+        }
+        return;
+    }
+    over_memory_budget_ = over_budget;
+}
+
+vector<pair<string_view, double>> SearchServer::ExpandTypos(const Query& query) const {
+    vector<pair<string_view, int>> typos;
+    for (const string_view word : query.plus_words) {
+        typo_index_.FindTerms(word, options_.max_typo_distance, typos);
+    }
+    // A term close to several plus-words counts once, at its smallest distance.
+    sort(typos.begin(), typos.end());
+    typos.erase(unique(typos.begin(), typos.end(),
+        [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; }), typos.end());
+
+    vector<pair<string_view, double>> terms;
+    for (const auto& [term, distance] : typos) {
+        if (find(query.plus_words.begin(), query.plus_words.end(), term) == query.plus_words.end()) {
+            terms.emplace_back(term, pow(options_.typo_penalty, distance));
+        }
+    }
+    return terms;
+}
+
+void SearchServer::MatchTypos(const Query& query, int document_id, vector<string_view>& matched_words) const {
+    if (options_.max_typo_distance == 0) {
+        return;
+    }
+    for (const auto& [term, _] : ExpandTypos(query)) {
+        if (word_to_document_freqs_.at(term).count(document_id)) {
+            matched_words.push_back(term);
+        }
+    }
+}
+
+size_t SearchServer::GetPositionalIndexSize() const {
+    return positional_index_.GetEncodedSize();
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    return lhs.relevance > rhs.relevance
+        || (abs(lhs.relevance - rhs.relevance) < DOUBLE_EPSILON && lhs.rating > rhs.rating);
 }
 
 double SearchServer::ComputeWordInverseDocumentFreq(const string_view& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+    return ComputeInverseDocumentFreq(TfIdfScorer{}, word);
+}
+
+Bm25Scorer SearchServer::MakeBm25Scorer() const {
+    const double average_document_length = shared_frequencies_ != nullptr
+        ? shared_frequencies_->GetAverageDocumentLength()
+        : documents_.empty() ? 0 : total_document_length_ * 1.0 / documents_.size();
+    return Bm25Scorer(options_.bm25_k1, options_.bm25_b, average_document_length);
 }
@@ -10,34 +10,119 @@
 #include <cmath>
 #include <iterator>
 #include <execution>
-#include <deque>
 #include <future>
+#include <optional>
+#include <memory>
+#include <array>
+#include <type_traits>
+#include <memory_resource>
+#include <functional>
+#include <iostream>
 
 #include "string_processing.h"
 #include "document.h"
 #include "concurrent_map.h"
+#include "stop_words.h"
+#include "metrics.h"
+#include "query_profile.h"
+#include "search_cursor.h"
+#include "positional_index.h"
+#include "document_frequencies.h"
+#include "document_set.h"
+#include "memory_stats.h"
+#include "typo_index.h"
+#include "posting_list.h"
+#include "scoring.h"
 
 using namespace std;
 
+class MutationLog;
+
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
 constexpr double DOUBLE_EPSILON = 1e-6;
 constexpr size_t PACKS_NUM = 120;
 
+struct SearchServerOptions {
+    // Keep word positions so that quoted phrases are matched inside the index.
+    // Without it phrases are checked by re-tokenizing the candidate documents.
+    bool positional_index = false;
+    // Upper bound on dictionary terms a "prefix*" query word expands to.
+    size_t max_prefix_expansions = 64;
+    // AND semantics: every plus-word is required, as if written "+word". Prefixes
+    // and typo expansions still only add to the score.
+    bool conjunctive_queries = false;
+    // Words found in at least this many documents also keep a document set,
+    // so that excluding them by a minus-word is a set union, not a posting walk.
+    size_t dense_word_min_documents = 64;
+    // Plus-words also match dictionary terms within this many typos (0 disables,
+    // at most 2; short words get fewer, see TypoIndex::GetAllowedDistance).
+    // A term at distance d is scored as an exact match times typo_penalty^d.
+    int max_typo_distance = 0;
+    double typo_penalty = 0.5;
+    // Relevance formula of the search; BM25 uses bm25_k1 and bm25_b.
+    Scoring scoring = Scoring::TF_IDF;
+    double bm25_k1 = 1.2;
+    double bm25_b = 0.75;
+    // Heap bytes (as reported by GetMemoryStats().GetTotalBytes()) above which
+    // on_memory_budget_exceeded is called after adding a document; zero disables
+    // the check. Without a handler a warning goes to cerr. The handler is called
+    // once per crossing and may remove documents to get back under the budget.
+    size_t memory_budget = 0;
+    function<void(const MemoryStats&)> on_memory_budget_exceeded;
+    // Serve the index containers from per-server pools instead of straight from the
+    // heap: nodes of one server stay together, and the pools hand their memory back
+    // in large blocks when the server is destroyed.
+    bool pooled_allocation = true;
+};
+
 class SearchServer {
 public:
+    class QueryContext;
+
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words)
-        : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+    explicit SearchServer(const StringContainer& stop_words, SearchServerOptions options = {})
+        : text_memory_(SelectUpstream(&index_pool_, options))
+        , inverted_index_memory_(SelectUpstream(&index_pool_, options))
+        , forward_index_memory_(SelectUpstream(&index_pool_, options))
+        , documents_memory_(SelectUpstream(&index_pool_, options))
+        , stop_words_memory_(SelectUpstream(&index_pool_, options))
+        , positional_index_memory_(SelectUpstream(&index_pool_, options))
+        , typo_index_memory_(SelectUpstream(&index_pool_, options))
+        , stop_words_(MakeUniqueNonEmptyStrings(stop_words), &stop_words_memory_)
+        , options_(move(options))
+        , positional_index_(&positional_index_memory_)
+        , typo_index_(options_.max_typo_distance, TypoIndex::DEFAULT_PREFIX_LENGTH, &typo_index_memory_)
     {
         if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
             throw invalid_argument("Some of stop words are invalid"s);
         }
     }
 
-    explicit SearchServer(const string& stop_words_text);
-    explicit SearchServer(string_view& stop_words_text);
+    explicit SearchServer(const string& stop_words_text, SearchServerOptions options = {});
+    explicit SearchServer(string_view& stop_words_text, SearchServerOptions options = {});
 
     void AddDocument(int document_id, const string_view& document, DocumentStatus status, const vector<int>& ratings);
+    // Indexes the text in place instead of copying it. The text must outlive the
+    // server; pass its owner to KeepAlive to tie the two lifetimes together.
+    void AddExternalDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings);
+    void KeepAlive(shared_ptr<const void> text_owner);
+    // Replaces the text, status and ratings of an existing document. Only postings
+    // whose term frequency changed are rewritten, so an unchanged text (a status or
+    // rating change) leaves the inverted index alone. Normalized term frequencies
+    // change with the word count, though: a text of another length rewrites the
+    // values of all of its postings, in place.
+    void UpdateDocument(int document_id, const string_view& document, DocumentStatus status, const vector<int>& ratings);
+
+    // Computes IDF and the BM25 average document length from the given
+    // collection-wide statistics instead of this server's own index. The caller
+    // keeps them up to date and alive.
+    void SetSharedFrequencies(const DocumentFrequencies* frequencies);
+
+    // Records every later AddDocument, UpdateDocument and RemoveDocument in the log,
+    // once applied: rejected calls never reach it. An update is logged as an add,
+    // which replay applies as a replacement. Pass nullptr to detach. The log must outlive
+    // the server or be detached first.
+    void SetMutationLog(MutationLog* mutation_log);
 
 
     template <typename DocumentPredicate>
@@ -48,20 +133,78 @@ public:
     template <typename DocumentPredicate, typename ExecutionPolicy>
     vector<Document> FindTopDocuments(const ExecutionPolicy& policy,
         const string_view& raw_query, DocumentPredicate document_predicate) const {
+        METRICS_TIMER(Timer::FIND_TOP_DOCUMENTS);
+        METRICS_ADD(Counter::QUERIES, 1);
         const auto query = ParseQuery(raw_query, true);
         auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-        sort(policy,
-            matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-                return lhs.relevance > rhs.relevance
-                    || (abs(lhs.relevance - rhs.relevance) < DOUBLE_EPSILON && lhs.rating > rhs.rating);
-            });
+        sort(policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
         if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
             matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
         }
         return matched_documents;
     }
 
+    // Profiling variant: same results as the sequential search, plus timings
+    // and per-term statistics in profile. The regular overloads do not pay for it.
+    template <typename DocumentPredicate>
+    vector<Document> FindTopDocuments(const string_view& raw_query, DocumentPredicate document_predicate,
+        QueryProfile& profile) const {
+        using Clock = chrono::steady_clock;
+        METRICS_TIMER(Timer::FIND_TOP_DOCUMENTS);
+        METRICS_ADD(Counter::QUERIES, 1);
+        profile = QueryProfile{};
+
+        const auto parse_start = Clock::now();
+        const auto query = ParseQuery(raw_query, true);
+        const auto scoring_start = Clock::now();
+        auto matched_documents = FindAllDocumentsImpl<true>(query, document_predicate, &profile);
+        const auto sort_start = Clock::now();
+        sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        }
+        const auto sort_end = Clock::now();
+
+        profile.parse_time = scoring_start - parse_start;
+        profile.scoring_time = sort_start - scoring_start;
+        profile.sort_time = sort_end - sort_start;
+        profile.results = matched_documents.size();
+        return matched_documents;
+    }
+
+    vector<Document> FindTopDocuments(
+        const string_view& raw_query, DocumentStatus status, QueryProfile& profile) const;
+
+    // Allocation-free variants: scratch space comes from the caller's context and the
+    // results are written to the caller's buffer, which is cleared first. Once the
+    // context and the buffer have grown to the workload, word and minus-word queries
+    // do not allocate; prefix and phrase queries still do for their expansions.
+    template <typename DocumentPredicate>
+    void FindTopDocuments(const string_view& raw_query, DocumentPredicate document_predicate,
+        QueryContext& context, vector<Document>& results) const;
+    void FindTopDocuments(const string_view& raw_query, DocumentStatus status,
+        QueryContext& context, vector<Document>& results) const;
+    void FindTopDocuments(const string_view& raw_query, QueryContext& context, vector<Document>& results) const;
+
+    // Scores the query once and returns a cursor serving the results page by page,
+    // without the MAX_RESULT_DOCUMENT_COUNT limit.
+    template <typename DocumentPredicate, typename ExecutionPolicy>
+    SearchCursor OpenSearchCursor(const ExecutionPolicy& policy,
+        const string_view& raw_query, DocumentPredicate document_predicate, size_t page_size) const {
+        METRICS_TIMER(Timer::FIND_TOP_DOCUMENTS);
+        METRICS_ADD(Counter::QUERIES, 1);
+        const auto query = ParseQuery(raw_query, true);
+        return SearchCursor(FindAllDocuments(policy, query, document_predicate), page_size);
+    }
+
+    template <typename DocumentPredicate>
+    SearchCursor OpenSearchCursor(const string_view& raw_query, DocumentPredicate document_predicate, size_t page_size) const {
+        return OpenSearchCursor(execution::seq, raw_query, document_predicate, page_size);
+    }
+
+    SearchCursor OpenSearchCursor(const string_view& raw_query, DocumentStatus status, size_t page_size) const;
+    SearchCursor OpenSearchCursor(const string_view& raw_query, size_t page_size) const;
+
     vector<Document> FindTopDocuments(
         const string_view& raw_query, DocumentStatus status) const;
 
@@ -80,10 +223,20 @@ public:
     vector<Document> FindTopDocuments(const execution::sequenced_policy&,
         const string_view& raw_query) const;
 
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+    // Bytes of encoded positions; zero unless the positional index is enabled.
+    size_t GetPositionalIndexSize() const;
+
+    // Live heap usage per structure, from the allocations made by the index
+    // containers. Cheap: reads counters, does not walk the index.
+    MemoryStats GetMemoryStats() const;
+
     int GetDocumentCount() const;
-    set<int>::const_iterator begin() const;
-    set<int>::const_iterator end() const;
-    const map<string_view, double>& GetWordFrequencies(int document_id) const;
+    pmr::set<int>::const_iterator begin() const;
+    pmr::set<int>::const_iterator end() const;
+    const pmr::map<string_view, double>& GetWordFrequencies(int document_id) const;
+    // Number of non-stop words, as used by BM25; zero for an unknown document.
+    size_t GetDocumentLength(int document_id) const;
 
     void RemoveDocument(int document_id);
     void RemoveDocument(const execution::sequenced_policy&, int document_id);
@@ -92,78 +245,341 @@ public:
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const string_view& raw_query, int document_id) const;
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const execution::sequenced_policy&, const string_view& raw_query, int document_id) const;
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const execution::parallel_policy&, const string_view& raw_query, int document_id) const;
+    tuple<vector<string_view>, DocumentStatus> MatchDocument(const string_view& raw_query, int document_id, QueryProfile& profile) const;
+    DocumentStatus MatchDocument(const string_view& raw_query, int document_id,
+        QueryContext& context, vector<string_view>& matched_words) const;
 
 private:
     struct DocumentData {
         int rating;
         DocumentStatus status;
+        string_view text;
+        // Non-stop words.
+        uint32_t length;
     };
 
     struct QueryWord {
         string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_required;
     };
 
     struct Query {
         vector<string_view> plus_words;
         vector<string_view> minus_words;
+        // "+word" words, also plus-words: only documents containing all of them match.
+        vector<string_view> required_words;
+        // Words of phrases are also plus-words; a document must contain every phrase.
+        vector<Phrase> phrases;
+        // "prefix*" words, without the asterisk.
+        vector<string_view> plus_prefixes;
+        vector<string_view> minus_prefixes;
+    };
+
+    // The DocumentStatus overloads filter through the status document sets
+    // instead of looking up every candidate in documents_.
+    struct StatusPredicate {
+        DocumentStatus status;
+
+        bool operator()(int, DocumentStatus document_status, int) const {
+            return document_status == status;
+        }
     };
 
 
 private:
-    deque<string> all_words_;
-    const set<string, less<>> stop_words_;
-    map<string_view, map<int, double>> word_to_document_freqs_;
-    map<int, map<string_view, double>> document_to_word_freqs_;
-    map<int, DocumentData> documents_;
-    set<int> document_ids_;
+    // Declared first: the containers below allocate from them. The per-structure
+    // trackers count what the containers request; heap_memory_ counts what is
+    // actually taken from the heap, by the pools or directly.
+    TrackingMemoryResource heap_memory_;
+    // Unsynchronized: no index container allocates or releases memory concurrently.
+    pmr::unsynchronized_pool_resource index_pool_{ &heap_memory_ };
+    TrackingMemoryResource text_memory_;
+    TrackingMemoryResource inverted_index_memory_;
+    TrackingMemoryResource forward_index_memory_;
+    TrackingMemoryResource documents_memory_;
+    TrackingMemoryResource stop_words_memory_;
+    TrackingMemoryResource positional_index_memory_;
+    TrackingMemoryResource typo_index_memory_;
+
+    // Owned texts by document id; external documents have none. A text is released
+    // when its document is removed or updated: no index key points into it.
+    pmr::map<int, pmr::string> document_texts_{ &text_memory_ };
+    vector<shared_ptr<const void>> text_owners_;
+    const StopWords stop_words_;
+    // Every indexed word once. All word keys below view these strings, and a word
+    // is released together with its posting list.
+    pmr::set<pmr::string, less<>> index_words_{ &inverted_index_memory_ };
+    pmr::map<string_view, PostingList> word_to_document_freqs_{ &inverted_index_memory_ };
+    pmr::map<int, pmr::map<string_view, double>> document_to_word_freqs_{ &forward_index_memory_ };
+    pmr::map<int, DocumentData> documents_{ &documents_memory_ };
+    pmr::set<int> document_ids_{ &documents_memory_ };
+    const SearchServerOptions options_;
+    PositionalIndex positional_index_;
+    TypoIndex typo_index_;
+    const DocumentFrequencies* shared_frequencies_ = nullptr;
+    MutationLog* mutation_log_ = nullptr;
+    pmr::map<string_view, DocumentSet> word_to_document_set_{ &inverted_index_memory_ };
+    array<DocumentSet, 4> status_to_documents_{
+        DocumentSet(&documents_memory_), DocumentSet(&documents_memory_),
+        DocumentSet(&documents_memory_), DocumentSet(&documents_memory_) };
+    size_t posting_count_ = 0;
+    size_t total_document_length_ = 0;
+    bool over_memory_budget_ = false;
 
 
 private:
+    pmr::memory_resource* SelectUpstream(pmr::memory_resource* pool, const SearchServerOptions& options);
     bool IsStopWord(const string_view& word) const;
     static bool IsValidWord(const string_view& word);
     vector<string_view> SplitIntoWordsNoStop(const string_view& text) const;
     static int ComputeAverageRating(const vector<int>& ratings);
     QueryWord ParseQueryWord(string_view text) const;
     Query ParseQuery(const string_view& text, bool purge) const;
+    void ParseQuery(const string_view& text, bool purge, Query& result, vector<string_view>& words) const;
+    void IndexDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings);
+    void ReindexDocument(int document_id, string_view document, DocumentData& document_data);
+    void IndexPositions(int document_id, string_view document);
+    // The posting list of the word, created empty under a key from index_words_.
+    pmr::map<string_view, PostingList>::iterator GetOrAddPostings(string_view word);
+    // Upkeep of the typo index, the dense document sets and emptied lists once a
+    // posting of the word has been added or erased.
+    void OnPostingAdded(string_view word, int document_id);
+    void OnPostingRemoved(string_view word, int document_id);
+    void RemovePosting(string_view word, int document_id);
+    void CheckMemoryBudget();
     double ComputeWordInverseDocumentFreq(const string_view& word) const;
+    Bm25Scorer MakeBm25Scorer() const;
+    bool MatchesPhrases(int document_id, const vector<Phrase>& phrases) const;
+    bool MatchesPhraseByRescan(int document_id, const Phrase& phrase) const;
+    vector<string_view> ExpandPrefix(string_view prefix) const;
+    PostingList MergePrefixPostings(string_view prefix) const;
+    bool MatchPrefixes(const Query& query, int document_id, vector<string_view>& matched_words) const;
+    // Dictionary terms within the typo distance of the plus-words, other than the
+    // plus-words themselves, with their score weight.
+    vector<pair<string_view, double>> ExpandTypos(const Query& query) const;
+    void MatchTypos(const Query& query, int document_id, vector<string_view>& matched_words) const;
+    void CollectExcludedDocuments(const Query& query, DocumentSet& excluded) const;
+    // Documents containing every required word, sorted by id. Intersects the posting
+    // lists starting from the shortest one.
+    void CollectCandidates(const Query& query, vector<int>& candidates) const;
+    bool ContainsRequiredWords(const Query& query, int document_id) const;
+    DocumentStatus MatchQuery(const Query& query, int document_id, vector<string_view>& matched_words) const;
+
+    template <typename Scorer>
+    double ComputeInverseDocumentFreq(const Scorer& scorer, string_view word) const {
+        if (shared_frequencies_ != nullptr) {
+            return scorer.ComputeInverseDocumentFreq(
+                shared_frequencies_->GetDocumentCount(), shared_frequencies_->GetDocumentFreq(word));
+        }
+        return scorer.ComputeInverseDocumentFreq(GetDocumentCount(), word_to_document_freqs_.at(word).size());
+    }
+
+    template <typename DocumentPredicate>
+    bool IsAccepted(int document_id, const DocumentPredicate& document_predicate) const {
+        if constexpr (is_same_v<DocumentPredicate, StatusPredicate>) {
+            return status_to_documents_[static_cast<size_t>(document_predicate.status)].Contains(document_id);
+        }
+        else {
+            const auto& document_data = documents_.at(document_id);
+            return document_predicate(document_id, document_data.status, document_data.rating);
+        }
+    }
 
     template <typename DocumentPredicate>
     vector<Document> FindAllDocuments(const execution::sequenced_policy&,
         const Query& query,
         DocumentPredicate document_predicate) const {
-        map<int, double> document_to_relevance;
+        return FindAllDocumentsImpl<false>(query, document_predicate, nullptr);
+    }
 
-        for (const string_view& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
+    template <bool Profiled, typename DocumentPredicate>
+    vector<Document> FindAllDocumentsImpl(const Query& query,
+        DocumentPredicate document_predicate, QueryProfile* profile) const {
+        DocumentSet excluded;
+        pmr::map<int, double> document_to_relevance;
+        vector<double> scores;
+        vector<int> candidates;
+        vector<Document> matched_documents;
+        FindAllDocumentsImpl<Profiled>(query, document_predicate, profile,
+            excluded, document_to_relevance, scores, candidates, matched_documents);
+        return matched_documents;
+    }
+
+    // Scratch containers are passed in so that QueryContext can reuse them.
+    template <bool Profiled, typename DocumentPredicate>
+    void FindAllDocumentsImpl(const Query& query, DocumentPredicate document_predicate, QueryProfile* profile,
+        DocumentSet& excluded, pmr::map<int, double>& document_to_relevance, vector<double>& scores,
+        vector<int>& candidates, vector<Document>& matched_documents) const {
+        // The scorer is chosen once per query; the scoring loops are compiled for each.
+        if (options_.scoring == Scoring::BM25) {
+            ScoreDocuments<Profiled>(MakeBm25Scorer(), query, document_predicate, profile,
+                excluded, document_to_relevance, scores, candidates, matched_documents);
+        }
+        else {
+            ScoreDocuments<Profiled>(TfIdfScorer{}, query, document_predicate, profile,
+                excluded, document_to_relevance, scores, candidates, matched_documents);
+        }
+    }
+
+    template <bool Profiled, typename Scorer, typename DocumentPredicate>
+    void ScoreDocuments(const Scorer& scorer, const Query& query, DocumentPredicate document_predicate,
+        QueryProfile* profile, DocumentSet& excluded, pmr::map<int, double>& document_to_relevance,
+        vector<double>& scores, vector<int>& candidates, vector<Document>& matched_documents) const {
+        document_to_relevance.clear();
+        // Minus-words go first: their documents are never scored.
+        CollectExcludedDocuments(query, excluded);
+        [[maybe_unused]] DocumentSet skipped;
+
+        // With required words only their common documents are scored, and every term
+        // looks them up by galloping instead of scanning its whole list.
+        const bool restricted = !query.required_words.empty();
+        if (restricted) {
+            CollectCandidates(query, candidates);
+            const auto rejected = remove_if(candidates.begin(), candidates.end(), [&](int document_id) {
+                if (excluded.Contains(document_id)) {
+                    if constexpr (Profiled) {
+                        if (IsAccepted(document_id, document_predicate)) {
+                            skipped.Add(document_id);
+                        }
+                    }
+                    return true;
+                }
+                return !IsAccepted(document_id, document_predicate);
+            });
+            candidates.erase(rejected, candidates.end());
+        }
+
+        const auto score_candidates = [&](string_view term, const PostingList& postings, double inverse_document_freq) {
+            const int* document_ids = postings.GetDocumentIds();
+            size_t position = 0;
+            size_t kept = 0;
+            for (const int document_id : candidates) {
+                position = postings.Seek(document_id, position);
+                if (position == postings.size()) {
+                    break;
+                }
+                if (document_ids[position] != document_id) {
+                    continue;
+                }
+                double score = 0;
+                scorer.ScorePostings(postings.GetTermFreqs() + position, postings.GetDocumentLengths() + position, 1,
+                    inverse_document_freq, &score);
+                document_to_relevance[document_id] += score;
+                ++kept;
+            }
+            METRICS_ADD(Counter::POSTINGS_SCANNED, kept);
+            if constexpr (Profiled) {
+                profile->terms.push_back({ string(term), false, postings.size(), inverse_document_freq, kept, postings.size() - kept });
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        };
+
+        // The kernel scores the whole list into scores; only the accumulation below
+        // looks at individual documents.
+        const auto score_postings = [&](string_view term, const PostingList& postings, double inverse_document_freq) {
+            if (restricted) {
+                score_candidates(term, postings, inverse_document_freq);
+                return;
+            }
+            METRICS_ADD(Counter::POSTINGS_SCANNED, postings.size());
+            scores.resize(postings.size());
+            scorer.ScorePostings(postings.GetTermFreqs(), postings.GetDocumentLengths(), postings.size(),
+                inverse_document_freq, scores.data());
+            const int* document_ids = postings.GetDocumentIds();
+            [[maybe_unused]] size_t kept = 0;
+            for (size_t i = 0; i < postings.size(); ++i) {
+                const int document_id = document_ids[i];
+                if (excluded.Contains(document_id)) {
+                    if constexpr (Profiled) {
+                        if (IsAccepted(document_id, document_predicate)) {
+                            skipped.Add(document_id);
+                        }
+                    }
+                    continue;
+                }
+                if (IsAccepted(document_id, document_predicate)) {
+                    document_to_relevance[document_id] += scores[i];
+                    if constexpr (Profiled) {
+                        ++kept;
+                    }
+                }
+            }
+            if constexpr (Profiled) {
+                profile->terms.push_back({ string(term), false, postings.size(), inverse_document_freq, kept, postings.size() - kept });
+            }
+        };
+
+        const auto score_word = [&](string_view word, double weight) {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it == word_to_document_freqs_.end()) {
+                if constexpr (Profiled) {
+                    profile->terms.push_back({ string(word), false });
                 }
+                return;
+            }
+            score_postings(word, it->second, ComputeInverseDocumentFreq(scorer, word) * weight);
+        };
+
+        for (const string_view& word : query.plus_words) {
+            score_word(word, 1.0);
+        }
+        if (options_.max_typo_distance > 0) {
+            for (const auto& [term, weight] : ExpandTypos(query)) {
+                score_word(term, weight);
             }
         }
 
-        for (const string_view& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
+        // All expansions of a prefix are scored as one term: frequencies are summed per
+        // document and the IDF is taken over the union of their documents.
+        for (const string_view prefix : query.plus_prefixes) {
+            const PostingList postings = MergePrefixPostings(prefix);
+            if (postings.empty()) {
+                if constexpr (Profiled) {
+                    profile->terms.push_back({ string(prefix), false });
+                }
                 continue;
             }
+            score_postings(prefix, postings, scorer.ComputeInverseDocumentFreq(GetDocumentCount(), postings.size()));
+        }
 
-            for (const auto& [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        if (!query.phrases.empty()) {
+            for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();) {
+                it = MatchesPhrases(it->first, query.phrases) ? next(it) : document_to_relevance.erase(it);
             }
         }
 
-        vector<Document> matched_documents;
+        if constexpr (Profiled) {
+            profile->candidates = document_to_relevance.size() + skipped.GetSize();
+            profile->removed_by_minus_words = skipped.GetSize();
+            const auto profile_minus_term = [&](string_view term, size_t postings, double inverse_document_freq,
+                const auto& document_ids) {
+                size_t removed = 0;
+                for (const auto& posting : document_ids) {
+                    removed += skipped.Contains(posting.first);
+                }
+                profile->terms.push_back({ string(term), true, postings, inverse_document_freq, postings - removed, removed });
+            };
+            for (const string_view& word : query.minus_words) {
+                if (word_to_document_freqs_.count(word) == 0) {
+                    profile->terms.push_back({ string(word), true });
+                    continue;
+                }
+                const auto& postings = word_to_document_freqs_.at(word);
+                profile_minus_term(word, postings.size(), ComputeInverseDocumentFreq(scorer, word), postings);
+            }
+            for (const string_view prefix : query.minus_prefixes) {
+                const auto postings = MergePrefixPostings(prefix);
+                profile_minus_term(prefix, postings.size(), 0, postings);
+            }
+        }
+
+        matched_documents.clear();
         for (const auto [document_id, relevance] : document_to_relevance) {
             matched_documents.push_back(
                 { document_id, relevance, documents_.at(document_id).rating });
         }
-        return matched_documents;
+        METRICS_ADD(Counter::DOCUMENTS_SCORED, matched_documents.size());
     }
 
 
@@ -171,52 +587,110 @@ private:
     vector<Document> FindAllDocuments(const execution::parallel_policy&,
         const Query& query,
         DocumentPredicate document_predicate) const {
+        if (options_.scoring == Scoring::BM25) {
+            return FindAllDocumentsParallel(MakeBm25Scorer(), query, document_predicate);
+        }
+        return FindAllDocumentsParallel(TfIdfScorer{}, query, document_predicate);
+    }
+
+    template <typename Scorer, typename DocumentPredicate>
+    vector<Document> FindAllDocumentsParallel(const Scorer& scorer, const Query& query,
+        DocumentPredicate document_predicate) const {
 
         ConcurrentMap<int, double> document_to_relevance_concurrent(PACKS_NUM);
+        DocumentSet excluded;
+        CollectExcludedDocuments(query, excluded);
+
+        const bool restricted = !query.required_words.empty();
+        vector<int> candidates;
+        if (restricted) {
+            CollectCandidates(query, candidates);
+            candidates.erase(remove_if(candidates.begin(), candidates.end(), [&](int document_id) {
+                return excluded.Contains(document_id) || !IsAccepted(document_id, document_predicate);
+            }), candidates.end());
+        }
 
+        const auto score_candidates = [&](const PostingList& postings, double inverse_document_freq) {
+                const int* document_ids = postings.GetDocumentIds();
+                size_t position = 0;
+                for (const int document_id : candidates) {
+                    position = postings.Seek(document_id, position);
+                    if (position == postings.size()) {
+                        break;
+                    }
+                    if (document_ids[position] == document_id) {
+                        double score = 0;
+                        scorer.ScorePostings(postings.GetTermFreqs() + position, postings.GetDocumentLengths() + position, 1,
+                            inverse_document_freq, &score);
+                        document_to_relevance_concurrent[document_id].ref_to_value += score;
+                    }
+                }
+            };
 
-        for_each(
-            execution::par,
-            query.plus_words.begin(),
-            query.plus_words.end(),
-            [&](string_view word) {
-                if (word_to_document_freqs_.count(word) == 0) {
+        const auto score_postings = [&](const PostingList& postings, double inverse_document_freq) {
+                if (restricted) {
+                    score_candidates(postings, inverse_document_freq);
                     return;
                 }
-
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+                METRICS_ADD(Counter::POSTINGS_SCANNED, postings.size());
+                vector<double> scores(postings.size());
+                scorer.ScorePostings(postings.GetTermFreqs(), postings.GetDocumentLengths(), postings.size(),
+                    inverse_document_freq, scores.data());
+                const int* document_ids = postings.GetDocumentIds();
+                // Parallel algorithms may pass copies of the elements, so the position
+                // travels as an index of its own.
+                vector<size_t> indexes(postings.size());
+                iota(indexes.begin(), indexes.end(), 0);
                 for_each(
                     execution::par,
-                    word_to_document_freqs_.at(word).begin(),
-                    word_to_document_freqs_.at(word).end(),
-                    [&](auto& elem) {
-                        auto& document_id = elem.first;
-                        auto& term_freq = elem.second;
-                        const auto& document_data = documents_.at(document_id);
-                        if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                            document_to_relevance_concurrent[document_id].ref_to_value += term_freq * inverse_document_freq;
+                    indexes.begin(),
+                    indexes.end(),
+                    [&](size_t index) {
+                        const int document_id = document_ids[index];
+                        if (!excluded.Contains(document_id) && IsAccepted(document_id, document_predicate)) {
+                            document_to_relevance_concurrent[document_id].ref_to_value += scores[index];
                         }
                     });
-            });
-
+            };
 
+        const auto score_word = [&](string_view word, double weight) {
+                const auto it = word_to_document_freqs_.find(word);
+                if (it != word_to_document_freqs_.end()) {
+                    score_postings(it->second, ComputeInverseDocumentFreq(scorer, word) * weight);
+                }
+            };
 
-        for (const string_view& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-
+        for_each(
+            execution::par,
+            query.plus_words.begin(),
+            query.plus_words.end(),
+            [&](string_view word) {
+                score_word(word, 1.0);
+            });
+        if (options_.max_typo_distance > 0) {
+            const auto typo_terms = ExpandTypos(query);
             for_each(
                 execution::par,
-                word_to_document_freqs_.at(word).begin(),
-                word_to_document_freqs_.at(word).end(),
-                [&](const auto& elem) {
-                    const auto& document_id = elem.first;
-                    document_to_relevance_concurrent.erase(document_id);
+                typo_terms.begin(),
+                typo_terms.end(),
+                [&](const auto& typo_term) {
+                    score_word(typo_term.first, typo_term.second);
                 });
         }
 
-        const auto document_to_relevance = move(document_to_relevance_concurrent.BuildOrdinaryMap());
+        for (const string_view prefix : query.plus_prefixes) {
+            const PostingList postings = MergePrefixPostings(prefix);
+            if (!postings.empty()) {
+                score_postings(postings, scorer.ComputeInverseDocumentFreq(GetDocumentCount(), postings.size()));
+            }
+        }
+
+        auto document_to_relevance = document_to_relevance_concurrent.BuildOrdinaryMap();
+        if (!query.phrases.empty()) {
+            for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();) {
+                it = MatchesPhrases(it->first, query.phrases) ? next(it) : document_to_relevance.erase(it);
+            }
+        }
 
         vector<Document> matched_documents(document_to_relevance.size());
         transform(
@@ -230,6 +704,39 @@ private:
                 return Document(document_id, relevance, documents_.at(document_id).rating);
             });
 
+        METRICS_ADD(Counter::DOCUMENTS_SCORED, matched_documents.size());
         return matched_documents;
     }
-};
\ No newline at end of file
+};
+
+class SearchServer::QueryContext {
+public:
+    QueryContext();
+
+private:
+    friend class SearchServer;
+
+    // Node-based scratch containers release into this pool and take from it again.
+    pmr::unsynchronized_pool_resource memory_;
+    Query query_;
+    vector<string_view> words_;
+    DocumentSet excluded_;
+    pmr::map<int, double> document_to_relevance_;
+    vector<double> scores_;
+    vector<int> candidates_;
+    vector<Document> matched_documents_;
+};
+
+template <typename DocumentPredicate>
+void SearchServer::FindTopDocuments(const string_view& raw_query, DocumentPredicate document_predicate,
+    QueryContext& context, vector<Document>& results) const {
+    METRICS_TIMER(Timer::FIND_TOP_DOCUMENTS);
+    METRICS_ADD(Counter::QUERIES, 1);
+    ParseQuery(raw_query, true, context.query_, context.words_);
+    auto& matched_documents = context.matched_documents_;
+    FindAllDocumentsImpl<false>(context.query_, document_predicate, nullptr,
+        context.excluded_, context.document_to_relevance_, context.scores_, context.candidates_, matched_documents);
+    sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    const size_t count = min(matched_documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    results.assign(matched_documents.begin(), matched_documents.begin() + count);
+}
@@ -0,0 +1,141 @@
+// Closed-loop load generator for the query service: every client thread keeps one
+// FIND request in flight on its own connection.
+//     g++ -std=c++17 -O2 service/load_generator.cpp $(ls *.cpp | grep -v '^main.cpp$') -ltbb -lpthread -o load_generator
+// Usage: load_generator <host> <port> [clients] [requests per client] [dictionary seed]
+// Queries are Zipf-distributed over a generated dictionary; for meaningful hit rates
+// load the service with a corpus built from the same dictionary.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../benchmark.h"
+#include "../generators.h"
+
+using namespace std;
+
+namespace {
+
+int Connect(const string& host, uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw runtime_error("socket: "s + strerror(errno));
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        close(fd);
+        throw runtime_error("Invalid address "s + host);
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        throw runtime_error("connect: "s + strerror(errno));
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return fd;
+}
+
+// Sends the request and reads one response line; returns false on a broken connection.
+bool RoundTrip(int fd, const string& request, string& buffer) {
+    size_t sent_total = 0;
+    while (sent_total < request.size()) {
+        const ssize_t sent = send(fd, request.data() + sent_total, request.size() - sent_total, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        sent_total += static_cast<size_t>(sent);
+    }
+    for (;;) {
+        const size_t end = buffer.find('\n');
+        if (end != buffer.npos) {
+            buffer.erase(0, end + 1);
+            return true;
+        }
+        char chunk[4096];
+        const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: "s << argv[0] << " <host> <port> [clients] [requests per client] [dictionary seed]"s << endl;
+        return 1;
+    }
+    const string host = argv[1];
+    const auto port = static_cast<uint16_t>(stoi(argv[2]));
+    const int clients = argc > 3 ? stoi(argv[3]) : 4;
+    const int requests_per_client = argc > 4 ? stoi(argv[4]) : 10'000;
+    const unsigned seed = argc > 5 ? static_cast<unsigned>(stoul(argv[5])) : 5489u;
+
+    mt19937 generator(seed);
+    const auto dictionary = GenerateDictionary(generator, 1'000, 10);
+    const ZipfDistribution distribution(dictionary.size(), 1.0);
+
+    vector<vector<double>> latencies(clients);
+    vector<int> failures(clients, 0);
+    vector<thread> threads;
+    const auto start = chrono::steady_clock::now();
+    for (int client = 0; client < clients; ++client) {
+        threads.emplace_back([&, client] {
+            mt19937 client_generator(seed + 1 + client);
+            const auto queries = GenerateZipfQueries(client_generator, dictionary, distribution, requests_per_client, 5, 0.1);
+            try {
+                const int fd = Connect(host, port);
+                string buffer;
+                latencies[client].reserve(queries.size());
+                for (const string& query : queries) {
+                    const auto request_start = chrono::steady_clock::now();
+                    if (!RoundTrip(fd, "FIND "s + query + "\n"s, buffer)) {
+                        ++failures[client];
+                        break;
+                    }
+                    latencies[client].push_back(static_cast<double>(
+                        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - request_start).count()));
+                }
+                close(fd);
+            }
+            catch (const exception& error) {
+                cerr << error.what() << endl;
+                ++failures[client];
+            }
+        });
+    }
+    for (thread& thread : threads) {
+        thread.join();
+    }
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> all_latencies;
+    int total_failures = 0;
+    for (int client = 0; client < clients; ++client) {
+        all_latencies.insert(all_latencies.end(), latencies[client].begin(), latencies[client].end());
+        total_failures += failures[client];
+    }
+    const BenchmarkStats stats = ComputeBenchmarkStats(move(all_latencies), 1);
+
+    cout << "requests: "s << stats.samples << ", failures: "s << total_failures
+        << ", qps: "s << (seconds > 0 ? stats.samples / seconds : 0.0)
+        << ", p50: "s << stats.p50_ns / 1000 << " us"s
+        << ", p99: "s << stats.p99_ns / 1000 << " us"s
+        << ", p999: "s << stats.p999_ns / 1000 << " us"s
+        << ", max: "s << stats.max_ns / 1000 << " us"s << endl;
+}
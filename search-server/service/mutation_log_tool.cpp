@@ -0,0 +1,40 @@
+// Maintenance of mutation logs. Build from search-server/ together with every source but main.cpp:
+//     g++ -std=c++17 -O2 service/mutation_log_tool.cpp $(ls *.cpp | grep -v '^main.cpp$') -ltbb -lpthread -o mutation_log_tool
+// Usage: mutation_log_tool inspect <log>
+//        mutation_log_tool truncate <log>
+// inspect counts the intact records and the torn tail. truncate empties the log;
+// run it once a new snapshot (corpus file) covers every record and the service
+// writing the log is stopped.
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "../mutation_log.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    if (argc != 3 || (argv[1] != "inspect"sv && argv[1] != "truncate"sv)) {
+        cerr << "Usage: "s << argv[0] << " inspect|truncate <log>"s << endl;
+        return 1;
+    }
+    try {
+        const string path = argv[2];
+        if (argv[1] == "truncate"sv) {
+            const MutationLogReplay before = InspectMutationLog(path);
+            MutationLog(path).Truncate();
+            cout << "Truncated "s << path << ": dropped "s << before.records << " records"s << endl;
+            return 0;
+        }
+        const MutationLogReplay log = InspectMutationLog(path);
+        cout << "records: "s << log.records << '\n'
+            << "adds: "s << log.added << '\n'
+            << "removes: "s << log.removed << '\n'
+            << "torn tail bytes: "s << log.discarded_bytes << endl;
+    }
+    catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+}
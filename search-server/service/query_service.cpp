@@ -0,0 +1,417 @@
+#include "query_service.h"
+
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <execution>
+#include <sstream>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t MAX_EVENTS = 256;
+constexpr size_t MAX_LINE_LENGTH = 1 << 20;
+constexpr size_t READ_CHUNK = 64 * 1024;
+// Per wakeup, so that one busy client cannot grow its buffers without bound.
+constexpr size_t MAX_READ_SIZE = 16 * READ_CHUNK;
+constexpr size_t MAX_PENDING_OUTPUT = 4 << 20;
+
+runtime_error SystemError(const string& what) {
+    return runtime_error(what + ": "s + strerror(errno));
+}
+
+string_view NextToken(string_view& text) {
+    const size_t space = text.find(' ');
+    const string_view token = text.substr(0, space);
+    text.remove_prefix(space == text.npos ? text.size() : space + 1);
+    return token;
+}
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        throw invalid_argument("invalid number "s + string(text));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("invalid status "s + string(text));
+}
+
+string_view GetStatusName(DocumentStatus status) {
+    switch (status) {
+    case DocumentStatus::ACTUAL:
+        return "ACTUAL"sv;
+    case DocumentStatus::IRRELEVANT:
+        return "IRRELEVANT"sv;
+    case DocumentStatus::BANNED:
+        return "BANNED"sv;
+    case DocumentStatus::REMOVED:
+        return "REMOVED"sv;
+    }
+    return "UNKNOWN"sv;
+}
+
+}  // namespace
+
+QueryService::QueryService(SearchServer& search_server, uint16_t port)
+    : search_server_(search_server) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw SystemError("socket"s);
+    }
+    const int enable = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(listen_fd_);
+        throw SystemError("bind"s);
+    }
+    if (listen(listen_fd_, SOMAXCONN) != 0) {
+        close(listen_fd_);
+        throw SystemError("listen"s);
+    }
+    socklen_t address_length = sizeof(address);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &address_length);
+    port_ = ntohs(address.sin_port);
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        close(listen_fd_);
+        throw SystemError("epoll_create1"s);
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+}
+
+QueryService::~QueryService() {
+    for (auto& [fd, _] : connections_) {
+        close(fd);
+    }
+    close(epoll_fd_);
+    close(listen_fd_);
+}
+
+uint16_t QueryService::GetPort() const {
+    return port_;
+}
+
+void QueryService::Stop() {
+    stopping_.store(true);
+}
+
+void QueryService::Run() {
+    epoll_event events[MAX_EVENTS];
+    vector<Connection*> ready;
+    vector<size_t> consumed;
+    vector<Request> requests;
+
+    while (!stopping_.load()) {
+        const int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, 100);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw SystemError("epoll_wait"s);
+        }
+
+        ready.clear();
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == listen_fd_) {
+                Accept();
+                continue;
+            }
+            Connection& connection = *connections_.at(events[i].data.fd);
+            if (events[i].events & EPOLLOUT) {
+                FlushOutput(connection);
+            }
+            if (IsReadable(connection) && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                connection.input_closed = !ReadFrom(connection);
+                ready.push_back(&connection);
+                continue;
+            }
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                connection.closing = true;
+            }
+            if (connection.closing || (connection.input_closed && connection.output.empty())) {
+                Close(connection);
+            }
+        }
+
+        // Requests keep views into the input buffers, which stay untouched until they are answered.
+        requests.clear();
+        consumed.assign(ready.size(), 0);
+        for (size_t i = 0; i < ready.size(); ++i) {
+            const string_view input = ready[i]->input;
+            size_t position = 0;
+            for (size_t end = input.find('\n'); end != input.npos; end = input.find('\n', position)) {
+                string_view line = input.substr(position, end - position);
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (!line.empty()) {
+                    requests.push_back(ParseRequest(*ready[i], line));
+                }
+                position = end + 1;
+            }
+            // The peer will not finish a last line without a newline.
+            if (ready[i]->input_closed && position < input.size()) {
+                string_view line = input.substr(position);
+                if (line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (!line.empty()) {
+                    requests.push_back(ParseRequest(*ready[i], line));
+                }
+                position = input.size();
+            }
+            consumed[i] = position;
+            if (input.size() - position > MAX_LINE_LENGTH) {
+                ready[i]->closing = true;
+            }
+        }
+
+        Execute(requests);
+        for (Request& request : requests) {
+            request.connection->output += request.response;
+            request.connection->output.push_back('\n');
+        }
+
+        for (size_t i = 0; i < ready.size(); ++i) {
+            Connection& connection = *ready[i];
+            connection.input.erase(0, consumed[i]);
+            FlushOutput(connection);
+            if (connection.closing || (connection.input_closed && connection.output.empty())) {
+                Close(connection);
+            }
+        }
+    }
+}
+
+void QueryService::Accept() {
+    for (;;) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        auto connection = make_unique<Connection>();
+        connection->fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+        connections_.emplace(fd, move(connection));
+    }
+}
+
+bool QueryService::IsReadable(const Connection& connection) const {
+    return !connection.input_closed && !connection.closing && connection.output.size() <= MAX_PENDING_OUTPUT;
+}
+
+// Returns false once the peer has closed its side. The rest of a long burst is
+// read on the next wakeup.
+bool QueryService::ReadFrom(Connection& connection) {
+    char buffer[READ_CHUNK];
+    for (size_t read_size = 0; read_size < MAX_READ_SIZE;) {
+        const ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, static_cast<size_t>(received));
+            read_size += static_cast<size_t>(received);
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+void QueryService::FlushOutput(Connection& connection) {
+    size_t sent_total = 0;
+    while (sent_total < connection.output.size()) {
+        const ssize_t sent = send(connection.fd, connection.output.data() + sent_total,
+            connection.output.size() - sent_total, MSG_NOSIGNAL);
+        if (sent > 0) {
+            sent_total += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        connection.closing = true;
+        break;
+    }
+    connection.output.erase(0, sent_total);
+    UpdateEvents(connection);
+}
+
+void QueryService::Close(Connection& connection) {
+    const int fd = connection.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
+
+void QueryService::UpdateEvents(Connection& connection) {
+    epoll_event event{};
+    event.events = (IsReadable(connection) ? static_cast<uint32_t>(EPOLLIN) : 0u)
+        | (connection.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    event.data.fd = connection.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+QueryService::Request QueryService::ParseRequest(Connection& connection, string_view line) {
+    Request request;
+    request.connection = &connection;
+    try {
+        const string_view command = NextToken(line);
+        if (command == "FIND"sv) {
+            request.type = RequestType::FIND;
+            request.query = line;
+        }
+        else if (command == "MATCH"sv) {
+            request.type = RequestType::MATCH;
+            request.document_id = ParseInt(NextToken(line));
+            request.query = line;
+        }
+        else if (command == "ADD"sv) {
+            request.type = RequestType::ADD;
+            request.document_id = ParseInt(NextToken(line));
+            request.status = ParseStatus(NextToken(line));
+            string_view ratings = NextToken(line);
+            while (!ratings.empty()) {
+                const size_t comma = ratings.find(',');
+                request.ratings.push_back(ParseInt(ratings.substr(0, comma)));
+                ratings.remove_prefix(comma == ratings.npos ? ratings.size() : comma + 1);
+            }
+            if (request.ratings.empty()) {
+                throw invalid_argument("no ratings"s);
+            }
+            request.query = line;
+        }
+        else if (command == "REMOVE"sv) {
+            request.type = RequestType::REMOVE;
+            request.document_id = ParseInt(NextToken(line));
+        }
+        else if (command == "MEMORY"sv) {
+            request.type = RequestType::MEMORY;
+        }
+        else {
+            throw invalid_argument("unknown command "s + string(command));
+        }
+    }
+    catch (const exception& error) {
+        request.type = RequestType::INVALID;
+        request.response = "ERR "s + error.what();
+    }
+    return request;
+}
+
+void QueryService::ExecuteReads(vector<Request*>& batch) const {
+    for_each(execution::par, batch.begin(), batch.end(), [this](Request* request) {
+        try {
+            if (request->type == RequestType::FIND) {
+                const auto documents = search_server_.FindTopDocuments(request->query);
+                request->response = "OK "s + to_string(documents.size());
+                char buffer[64];
+                for (const Document& document : documents) {
+                    const int length = snprintf(buffer, sizeof(buffer), " %d %.6g %d",
+                        document.id, document.relevance, document.rating);
+                    request->response.append(buffer, static_cast<size_t>(length));
+                }
+            }
+            else if (request->type == RequestType::MEMORY) {
+                ostringstream out;
+                search_server_.GetMemoryStats().PrintJson(out);
+                request->response = "OK "s + out.str();
+            }
+            else {
+                const auto [words, status] = search_server_.MatchDocument(request->query, request->document_id);
+                request->response = "OK "s;
+                request->response += GetStatusName(status);
+                for (const string_view word : words) {
+                    request->response.push_back(' ');
+                    request->response += word;
+                }
+            }
+        }
+        catch (const exception& error) {
+            request->response = "ERR "s + error.what();
+        }
+    });
+    batch.clear();
+}
+
+void QueryService::ExecuteWrite(Request& request) {
+    try {
+        if (request.type == RequestType::ADD) {
+            search_server_.AddDocument(request.document_id, request.query, request.status, request.ratings);
+        }
+        else {
+            search_server_.RemoveDocument(request.document_id);
+        }
+        request.response = "OK"s;
+    }
+    catch (const exception& error) {
+        request.response = "ERR "s + error.what();
+    }
+}
+
+void QueryService::Execute(vector<Request>& requests) {
+    vector<Request*> batch;
+    for (Request& request : requests) {
+        switch (request.type) {
+        case RequestType::FIND:
+        case RequestType::MATCH:
+        case RequestType::MEMORY:
+            batch.push_back(&request);
+            break;
+        case RequestType::ADD:
+        case RequestType::REMOVE:
+            ExecuteReads(batch);
+            ExecuteWrite(request);
+            break;
+        case RequestType::INVALID:
+            break;
+        }
+    }
+    ExecuteReads(batch);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../search_server.h"
+
+using namespace std;
+
+// Non-blocking TCP front-end for a SearchServer, driven by a single epoll loop.
+// Requests are text lines; answers are single lines in request order:
+//     FIND <query>                         -> OK <n>[ <id> <relevance> <rating>]...
+//     MATCH <id> <query>                   -> OK <status>[ <word>]...
+//     ADD <id> <status> <r1,r2,...> <text> -> OK
+//     REMOVE <id>                          -> OK
+//     MEMORY                               -> OK <MemoryStats as JSON>
+// Errors are answered with "ERR <message>".
+// A connection whose peer shuts down its sending side is closed once all answers
+// are sent; one with more than MAX_PENDING_OUTPUT (4 MB) unsent bytes is not read from
+// until its peer catches up.
+// Lines are parsed in place in the connection buffers. All FIND and MATCH requests
+// that arrive in one loop iteration run as one parallel batch, the way ProcessQueries
+// does; ADD and REMOVE split the batch, so every client sees its requests in order.
+class QueryService {
+public:
+    QueryService(SearchServer& search_server, uint16_t port);
+    ~QueryService();
+
+    QueryService(const QueryService&) = delete;
+    QueryService& operator=(const QueryService&) = delete;
+
+    uint16_t GetPort() const;
+
+    // Serves until Stop is called from another thread or a signal handler.
+    void Run();
+    void Stop();
+
+private:
+    struct Connection {
+        int fd = -1;
+        string input;
+        string output;
+        // The peer finished sending: the connection is closed once output drains.
+        bool input_closed = false;
+        // Broken or misbehaving: closed without flushing.
+        bool closing = false;
+    };
+
+    enum class RequestType {
+        FIND,
+        MATCH,
+        ADD,
+        REMOVE,
+        MEMORY,
+        INVALID,
+    };
+
+    struct Request {
+        Connection* connection = nullptr;
+        RequestType type = RequestType::INVALID;
+        string_view query;
+        int document_id = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        vector<int> ratings;
+        string response;
+    };
+
+    SearchServer& search_server_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    uint16_t port_ = 0;
+    atomic<bool> stopping_ = false;
+    unordered_map<int, unique_ptr<Connection>> connections_;
+
+    void Accept();
+    bool IsReadable(const Connection& connection) const;
+    bool ReadFrom(Connection& connection);
+    void FlushOutput(Connection& connection);
+    void Close(Connection& connection);
+    void UpdateEvents(Connection& connection);
+
+    static Request ParseRequest(Connection& connection, string_view line);
+    void ExecuteReads(vector<Request*>& batch) const;
+    void ExecuteWrite(Request& request);
+    void Execute(vector<Request>& requests);
+};
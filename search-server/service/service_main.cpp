@@ -0,0 +1,65 @@
+// Standalone query service. Build from search-server/ together with every source but main.cpp:
+//     g++ -std=c++17 -O2 service/service_main.cpp service/query_service.cpp $(ls *.cpp | grep -v '^main.cpp$') -ltbb -lpthread -o search_service
+// Usage: search_service <port> [corpus file] [stop words] [mutation log]
+// The corpus file has the LoadCorpus format; without it the service starts empty.
+// With a mutation log, the log is replayed on top of the corpus and every ADD and
+// REMOVE is appended to it, so that they survive a restart. An empty corpus file
+// name starts the service from the log alone.
+
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../mapped_corpus.h"
+#include "../mutation_log.h"
+#include "../search_server.h"
+#include "query_service.h"
+
+using namespace std;
+
+namespace {
+
+QueryService* running_service = nullptr;
+
+void HandleSignal(int) {
+    if (running_service != nullptr) {
+        running_service->Stop();
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: "s << argv[0] << " <port> [corpus file] [stop words] [mutation log]"s << endl;
+        return 1;
+    }
+    try {
+        SearchServer search_server(argc > 3 ? string(argv[3]) : string());
+        if (argc > 2 && argv[2][0] != '\0') {
+            const size_t loaded = LoadCorpus(search_server, argv[2]);
+            cerr << "Loaded "s << loaded << " documents"s << endl;
+        }
+        unique_ptr<MutationLog> mutation_log;
+        if (argc > 4) {
+            mutation_log = make_unique<MutationLog>(argv[4]);
+            const MutationLogReplay replay = ReplayMutationLog(search_server, argv[4]);
+            cerr << "Replayed "s << replay.records << " mutations: "s << replay.added << " added, "s
+                << replay.removed << " removed"s << endl;
+            search_server.SetMutationLog(mutation_log.get());
+        }
+
+        QueryService service(search_server, static_cast<uint16_t>(stoi(argv[1])));
+        running_service = &service;
+        signal(SIGINT, HandleSignal);
+        signal(SIGTERM, HandleSignal);
+        cerr << "Listening on port "s << service.GetPort() << endl;
+        service.Run();
+        running_service = nullptr;
+    }
+    catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+}
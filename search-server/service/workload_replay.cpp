@@ -0,0 +1,90 @@
+// Open-loop replay of captured or generated workloads against an in-process server.
+// Build from search-server/ together with every source but main.cpp:
+//     g++ -std=c++17 -O2 service/workload_replay.cpp $(ls *.cpp | grep -v '^main.cpp$') -ltbb -lpthread -o workload_replay
+// Usage: workload_replay generate <corpus out> <workload out> [documents] [queries] [mean qps] [zipf exponent]
+//        workload_replay replay <corpus> <workload> [qps] [clients]
+// generate writes a corpus in the LoadCorpus format and a bursty workload, both with
+// Zipf-distributed words over one generated dictionary. replay loads the corpus and
+// plays the workload (captured by a WorkloadRecorder or generated) at its recorded
+// arrival times, or evenly spaced at qps when given and non-zero.
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "../generators.h"
+#include "../mapped_corpus.h"
+#include "../search_server.h"
+#include "../workload.h"
+
+using namespace std;
+
+namespace {
+
+void Generate(int argc, char* argv[]) {
+    const int document_count = argc > 4 ? stoi(argv[4]) : 10'000;
+    WorkloadShape shape;
+    shape.query_count = argc > 5 ? stoi(argv[5]) : shape.query_count;
+    shape.mean_qps = argc > 6 ? stod(argv[6]) : shape.mean_qps;
+    const double zipf_exponent = argc > 7 ? stod(argv[7]) : 1.0;
+
+    mt19937 generator(5489u);
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const ZipfDistribution distribution(dictionary.size(), zipf_exponent);
+
+    ofstream corpus(argv[2]);
+    for (int id = 0; id < document_count; ++id) {
+        corpus << id << "\tACTUAL\t"s << uniform_int_distribution(1, 10)(generator) << '\t'
+            << GenerateZipfQuery(generator, dictionary, distribution, 70) << '\n';
+    }
+    if (!corpus) {
+        throw runtime_error("Cannot write "s + argv[2]);
+    }
+    SaveWorkload(argv[3], GenerateWorkload(generator, dictionary, distribution, shape));
+    cerr << "Generated "s << document_count << " documents and "s << shape.query_count << " queries"s << endl;
+}
+
+void Replay(int argc, char* argv[]) {
+    SearchServer search_server(""s);
+    LoadCorpus(search_server, argv[2]);
+    const auto workload = LoadWorkload(argv[3]);
+    WorkloadReplayOptions options;
+    options.qps = argc > 4 ? stod(argv[4]) : 0;
+    if (argc > 5) {
+        options.clients = stoul(argv[5]);
+    }
+
+    const WorkloadReplayStats stats = ReplayWorkload(search_server, workload, options);
+    cout << "queries: "s << stats.latency.samples
+        << "\nempty results: "s << stats.empty_results
+        << "\nduration: "s << chrono::duration<double>(stats.duration).count() << " s"s
+        << "\nthroughput: "s << stats.throughput_qps << " qps"s
+        << "\nlatency: p50 = "s << static_cast<uint64_t>(stats.latency.p50_ns)
+        << " ns, p99 = "s << static_cast<uint64_t>(stats.latency.p99_ns)
+        << " ns, p999 = "s << static_cast<uint64_t>(stats.latency.p999_ns)
+        << " ns, max = "s << static_cast<uint64_t>(stats.latency.max_ns) << " ns"s << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 4 || (argv[1] != "generate"sv && argv[1] != "replay"sv)) {
+        cerr << "Usage: "s << argv[0] << " generate <corpus out> <workload out> [documents] [queries] [mean qps] [zipf exponent]\n"s
+            << "       "s << argv[0] << " replay <corpus> <workload> [qps] [clients]"s << endl;
+        return 1;
+    }
+    try {
+        if (argv[1] == "generate"sv) {
+            Generate(argc, argv);
+        }
+        else {
+            Replay(argc, argv);
+        }
+    }
+    catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+}
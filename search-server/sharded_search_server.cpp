@@ -0,0 +1,59 @@
+#include "sharded_search_server.h"
+
+ShardedSearchServer::ShardedSearchServer(const string& stop_words_text, size_t shard_count, SearchServerOptions options)
+    : ShardedSearchServer(SplitIntoWords(string_view(stop_words_text)), shard_count, options) {
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    Shard& shard = GetShardFor(document_id);
+    lock_guard lock(shard.mutex);
+    shard.server.AddDocument(document_id, document, status, ratings);
+    frequencies_->AddDocument(shard.server.GetWordFrequencies(document_id), shard.server.GetDocumentLength(document_id));
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    Shard& shard = GetShardFor(document_id);
+    lock_guard lock(shard.mutex);
+    const pmr::map<string_view, double> words = shard.server.GetWordFrequencies(document_id);
+    const size_t length = shard.server.GetDocumentLength(document_id);
+    const int document_count = shard.server.GetDocumentCount();
+    shard.server.RemoveDocument(document_id);
+    if (shard.server.GetDocumentCount() < document_count) {
+        frequencies_->RemoveDocument(words, length);
+    }
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    // Through the status overload, which filters by the shard's status sets.
+    return FindOnAllShards([&](const SearchServer& shard) {
+        return shard.FindTopDocuments(execution::seq, raw_query, status);
+    });
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    const Shard& shard = GetShardFor(document_id);
+    shared_lock lock(shard.mutex);
+    return shard.server.MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return frequencies_->GetDocumentCount();
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const {
+    return shards_.at(index)->server;
+}
+
+ShardedSearchServer::Shard& ShardedSearchServer::GetShardFor(int document_id) const {
+    // Fibonacci hashing spreads consecutive ids over all shards.
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ULL;
+    return *shards_[(hash >> 32) % shards_.size()];
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+#include "document_frequencies.h"
+
+using namespace std;
+
+// Documents partitioned by id hash across independent SearchServer shards.
+// The shards share one DocumentFrequencies, so IDF, the BM25 average length and
+// therefore the results are the same as those of a single SearchServer holding all documents
+// (prefix* queries excepted: their expansion and IDF stay per shard).
+// Writes go to one shard; queries run on all shards in parallel and the
+// per-shard top results are merged.
+// Thread-safe: a write locks only its shard, so writes to different shards run
+// in parallel, and queries lock every shard for reading. GetShard is not locked.
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer& stop_words, size_t shard_count, SearchServerOptions options = {})
+        : frequencies_(make_unique<DocumentFrequencies>()) {
+        if (shard_count == 0) {
+            throw invalid_argument("Shard count must be positive"s);
+        }
+        shards_.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.push_back(make_unique<Shard>(stop_words, options));
+            shards_.back()->server.SetSharedFrequencies(frequencies_.get());
+        }
+    }
+
+    ShardedSearchServer(const string& stop_words_text, size_t shard_count, SearchServerOptions options = {});
+
+    void AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    vector<Document> FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate) const {
+        return FindOnAllShards([&](const SearchServer& shard) {
+            return shard.FindTopDocuments(execution::seq, raw_query, document_predicate);
+        });
+    }
+
+    vector<Document> FindTopDocuments(string_view raw_query, DocumentStatus status) const;
+    vector<Document> FindTopDocuments(string_view raw_query) const;
+
+    tuple<vector<string_view>, DocumentStatus> MatchDocument(string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+    const SearchServer& GetShard(size_t index) const;
+
+private:
+    struct Shard {
+        template <typename StringContainer>
+        Shard(const StringContainer& stop_words, const SearchServerOptions& options)
+            : server(stop_words, options) {
+        }
+
+        SearchServer server;
+        mutable shared_mutex mutex;
+    };
+
+    vector<unique_ptr<Shard>> shards_;
+    unique_ptr<DocumentFrequencies> frequencies_;
+
+    Shard& GetShardFor(int document_id) const;
+
+    // Runs find on every shard in parallel and merges the per-shard top results.
+    template <typename Find>
+    vector<Document> FindOnAllShards(Find find) const {
+        vector<vector<Document>> shard_results(shards_.size());
+        transform(execution::par, shards_.begin(), shards_.end(), shard_results.begin(),
+            [&](const unique_ptr<Shard>& shard) {
+                shared_lock lock(shard->mutex);
+                return find(shard->server);
+            });
+
+        vector<Document> documents;
+        for (const auto& results : shard_results) {
+            documents.insert(documents.end(), results.begin(), results.end());
+        }
+        const size_t result_count = min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+        partial_sort(documents.begin(), documents.begin() + result_count, documents.end(), SearchServer::IsMoreRelevant);
+        documents.resize(result_count);
+        return documents;
+    }
+};
@@ -0,0 +1,33 @@
+#include "stop_words.h"
+
+StopWords::StopWords(const set<string, less<>>& words, pmr::memory_resource* resource)
+    : words_(words.begin(), words.end(), resource)
+    , slots_(resource)
+    , displacements_(resource) {
+    vector<string_view> views(words_.begin(), words_.end());
+    for (const string_view word : views) {
+        if (word.empty()) {
+            throw invalid_argument("Stop word is empty"s);
+        }
+        prefilter_.Add(word);
+    }
+
+    const size_t bucket_count = StopWordBucketCount(views.size());
+    vector<uint64_t> hashes(views.size());
+    vector<size_t> order(views.size());
+    vector<size_t> bucket_starts(bucket_count + 1);
+    const StopWordTableScratch scratch{ hashes.data(), order.data(), bucket_starts.data() };
+    for (size_t table_size = StopWordTableSize(views.size()); ; table_size <<= 1) {
+        slots_.assign(table_size, string_view());
+        displacements_.assign(bucket_count, 0);
+        const StopWordTableStatus status = BuildStopWordTable(views.data(), views.size(), slots_.data(), table_size,
+            displacements_.data(), bucket_count, scratch);
+        if (status == StopWordTableStatus::OK) {
+            break;
+        }
+        // The words come from a set: only placement can fail.
+        if (status == StopWordTableStatus::DUPLICATE_WORDS || table_size > views.size() * 64) {
+            throw logic_error("Unable to build stop words table"s);
+        }
+    }
+}
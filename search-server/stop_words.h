@@ -0,0 +1,266 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Membership test for the stop-word list, compiled once at construction.
+// A word first goes through a cheap prefilter (known lengths and first bytes),
+// then through a hash-and-displace perfect hash: one string hash picks a bucket,
+// the bucket's displacement gives the only slot the word may occupy.
+
+constexpr uint64_t StopWordHash(string_view word) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : word) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+constexpr uint64_t StopWordSlotMix(uint64_t hash, uint32_t displacement) {
+    uint64_t x = hash + (displacement + 1ULL) * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+constexpr size_t StopWordTableSize(size_t words_count) {
+    size_t size = 1;
+    while (size < words_count * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+constexpr size_t StopWordBucketCount(size_t words_count) {
+    return words_count / 2 + 1;
+}
+
+struct StopWordPrefilter {
+    uint64_t lengths = 0;
+    uint64_t first_bytes[4] = {};
+
+    constexpr void Add(string_view word) {
+        lengths |= 1ULL << (word.size() < 63 ? word.size() : 63);
+        const uint8_t first = static_cast<uint8_t>(word[0]);
+        first_bytes[first >> 6] |= 1ULL << (first & 63);
+    }
+
+    constexpr bool MayContain(string_view word) const {
+        if (word.empty()) {
+            return false;
+        }
+        if ((lengths & (1ULL << (word.size() < 63 ? word.size() : 63))) == 0) {
+            return false;
+        }
+        const uint8_t first = static_cast<uint8_t>(word[0]);
+        return (first_bytes[first >> 6] & (1ULL << (first & 63))) != 0;
+    }
+};
+
+enum class StopWordTableStatus {
+    OK,
+    DUPLICATE_WORDS,
+    // No displacement places some bucket; a larger table may succeed.
+    PLACEMENT_FAILED,
+};
+
+// Working memory of BuildStopWordTable, provided by the caller so that the build
+// also runs in constant evaluation: words_count hashes and indices, and
+// bucket_count + 1 bucket offsets.
+struct StopWordTableScratch {
+    uint64_t* hashes;
+    size_t* order;
+    size_t* bucket_starts;
+};
+
+// Fills slots[0..table_size) and displacements[0..bucket_count) for the given
+// non-empty words. Every word is hashed once and the words are grouped by bucket
+// with a counting sort, so apart from the displacement search the build is linear.
+constexpr StopWordTableStatus BuildStopWordTable(const string_view* words, size_t words_count,
+    string_view* slots, size_t table_size,
+    uint32_t* displacements, size_t bucket_count, const StopWordTableScratch& scratch) {
+    constexpr uint32_t max_displacement = 1U << 16;
+    const uint64_t mask = table_size - 1;
+    uint64_t* const hashes = scratch.hashes;
+    size_t* const order = scratch.order;
+    size_t* const bucket_starts = scratch.bucket_starts;
+
+    for (size_t bucket = 0; bucket <= bucket_count; ++bucket) {
+        bucket_starts[bucket] = 0;
+    }
+    for (size_t i = 0; i < words_count; ++i) {
+        hashes[i] = StopWordHash(words[i]);
+        ++bucket_starts[hashes[i] % bucket_count];
+    }
+    // Turns the sizes into bucket ends, then fills every bucket from its end,
+    // which leaves bucket_starts[bucket] at the bucket's start.
+    size_t max_bucket_size = 0;
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        max_bucket_size = bucket_starts[bucket] > max_bucket_size ? bucket_starts[bucket] : max_bucket_size;
+        bucket_starts[bucket] += bucket > 0 ? bucket_starts[bucket - 1] : 0;
+    }
+    bucket_starts[bucket_count] = words_count;
+    for (size_t i = words_count; i > 0; --i) {
+        order[--bucket_starts[hashes[i - 1] % bucket_count]] = i - 1;
+    }
+
+    // Equal words hash alike, so duplicates can only share a bucket.
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        for (size_t i = bucket_starts[bucket]; i < bucket_starts[bucket + 1]; ++i) {
+            for (size_t j = i + 1; j < bucket_starts[bucket + 1]; ++j) {
+                if (words[order[i]] == words[order[j]]) {
+                    return StopWordTableStatus::DUPLICATE_WORDS;
+                }
+            }
+        }
+    }
+
+    // Largest buckets first: they are the hardest to place.
+    for (size_t bucket_size = max_bucket_size; bucket_size > 0; --bucket_size) {
+        for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            const size_t first = bucket_starts[bucket];
+            const size_t last = bucket_starts[bucket + 1];
+            if (last - first != bucket_size) {
+                continue;
+            }
+
+            bool placed = false;
+            for (uint32_t displacement = 0; !placed && displacement < max_displacement; ++displacement) {
+                placed = true;
+                size_t done = first;
+                for (; done < last; ++done) {
+                    string_view& slot = slots[StopWordSlotMix(hashes[order[done]], displacement) & mask];
+                    if (!slot.empty()) {
+                        placed = false;
+                        break;
+                    }
+                    slot = words[order[done]];
+                }
+                if (!placed) {
+                    for (size_t i = first; i < done; ++i) {
+                        slots[StopWordSlotMix(hashes[order[i]], displacement) & mask] = string_view();
+                    }
+                }
+                else {
+                    displacements[bucket] = displacement;
+                }
+            }
+            if (!placed) {
+                return StopWordTableStatus::PLACEMENT_FAILED;
+            }
+        }
+    }
+    return StopWordTableStatus::OK;
+}
+
+class StopWords {
+public:
+    StopWords() = default;
+    explicit StopWords(const set<string, less<>>& words, pmr::memory_resource* resource = pmr::get_default_resource());
+
+    // Neither copyable nor movable: the table views the words it owns, and a copy
+    // or a move with another memory resource would leave it pointing at the original.
+    StopWords(const StopWords&) = delete;
+    StopWords& operator=(const StopWords&) = delete;
+
+    bool Contains(string_view word) const {
+        if (!prefilter_.MayContain(word)) {
+            return false;
+        }
+        const uint64_t hash = StopWordHash(word);
+        const uint32_t displacement = displacements_[hash % displacements_.size()];
+        return slots_[StopWordSlotMix(hash, displacement) & (slots_.size() - 1)] == word;
+    }
+
+    size_t size() const {
+        return words_.size();
+    }
+
+    pmr::set<pmr::string, less<>>::const_iterator begin() const {
+        return words_.begin();
+    }
+
+    pmr::set<pmr::string, less<>>::const_iterator end() const {
+        return words_.end();
+    }
+
+private:
+    pmr::set<pmr::string, less<>> words_;
+    StopWordPrefilter prefilter_;
+    pmr::vector<string_view> slots_ = pmr::vector<string_view>(1);
+    pmr::vector<uint32_t> displacements_ = pmr::vector<uint32_t>(1);
+};
+
+// Compile-time stop list:
+//     constexpr auto stop_words = MakeStaticStopWords<3>({ "a"sv, "in"sv, "the"sv });
+//     static_assert(stop_words.Contains("in"sv));
+// Words must be non-empty and distinct. The object is iterable, so it can be
+// passed to the SearchServer constructor as any other string container.
+template <size_t N>
+class StaticStopWords {
+public:
+    static constexpr size_t TABLE_SIZE = StopWordTableSize(N);
+    static constexpr size_t BUCKET_COUNT = StopWordBucketCount(N);
+
+    constexpr explicit StaticStopWords(const array<string_view, N>& words)
+        : words_(words) {
+        for (const string_view word : words_) {
+            if (word.empty()) {
+                throw invalid_argument("Stop word is empty");
+            }
+            prefilter_.Add(word);
+        }
+        array<uint64_t, N> hashes = {};
+        array<size_t, N> order = {};
+        array<size_t, BUCKET_COUNT + 1> bucket_starts = {};
+        const StopWordTableStatus status = BuildStopWordTable(words_.data(), N, slots_.data(), TABLE_SIZE,
+            displacements_.data(), BUCKET_COUNT, { hashes.data(), order.data(), bucket_starts.data() });
+        if (status == StopWordTableStatus::DUPLICATE_WORDS) {
+            throw invalid_argument("Stop words contain duplicates");
+        }
+        if (status == StopWordTableStatus::PLACEMENT_FAILED) {
+            throw logic_error("Unable to build stop words table");
+        }
+    }
+
+    constexpr bool Contains(string_view word) const {
+        if (!prefilter_.MayContain(word)) {
+            return false;
+        }
+        const uint64_t hash = StopWordHash(word);
+        const uint32_t displacement = displacements_[hash % BUCKET_COUNT];
+        return slots_[StopWordSlotMix(hash, displacement) & (TABLE_SIZE - 1)] == word;
+    }
+
+    constexpr size_t size() const {
+        return N;
+    }
+
+    constexpr auto begin() const {
+        return words_.begin();
+    }
+
+    constexpr auto end() const {
+        return words_.end();
+    }
+
+private:
+    array<string_view, N> words_;
+    StopWordPrefilter prefilter_;
+    array<string_view, TABLE_SIZE> slots_ = {};
+    array<uint32_t, BUCKET_COUNT> displacements_ = {};
+};
+
+template <size_t N>
+constexpr StaticStopWords<N> MakeStaticStopWords(const array<string_view, N>& words) {
+    return StaticStopWords<N>(words);
+}
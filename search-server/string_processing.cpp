@@ -3,6 +3,13 @@
 vector<string_view> SplitIntoWords(string_view text) {
 
     vector<string_view> words;
+    SplitIntoWords(text, words);
+    return words;
+}
+
+void SplitIntoWords(string_view text, vector<string_view>& words) {
+
+    words.clear();
 
     while (true) {
         const auto pos = text.find(' ');
@@ -18,5 +25,4 @@ vector<string_view> SplitIntoWords(string_view text) {
             text.remove_prefix(pos + 1);
         }
     }
-    return words;
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 using namespace std;
 
 vector<string_view> SplitIntoWords(string_view text);
+// Same, into a reused buffer: words is cleared first and keeps its capacity.
+void SplitIntoWords(string_view text, vector<string_view>& words);
 
 template <typename StringContainer>
 set<string, less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
@@ -0,0 +1,45 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace {
+
+thread_local size_t* allocation_counter = nullptr;
+
+} // namespace
+
+AllocationCounter::AllocationCounter() {
+    allocation_counter = &count_;
+}
+
+AllocationCounter::~AllocationCounter() {
+    allocation_counter = nullptr;
+}
+
+size_t AllocationCounter::GetCount() const {
+    return count_;
+}
+
+// Global operator new counting allocations made by the current thread while a
+// counter is installed. Backed by malloc, as the default one is.
+void* operator new(size_t size) {
+    if (allocation_counter != nullptr) {
+        ++*allocation_counter;
+    }
+    if (void* p = malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+// Not inlined into this file's callers, where GCC would see free() paired with new.
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts the heap allocations made by the current thread while it is alive. The
+// count comes from the replacement global operator new in allocation_counter.cpp,
+// which only the test binary links.
+class AllocationCounter {
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    std::size_t GetCount() const;
+
+private:
+    std::size_t count_ = 0;
+};
@@ -0,0 +1,43 @@
+// Checks of the search server. Build from search-server/ together with the query service
+// and every source but main.cpp:
+//     g++ -std=c++17 -O2 tests/*.cpp service/query_service.cpp $(ls *.cpp | grep -v '^main.cpp$') -ltbb -lpthread -o run_tests
+// The tests replace the global operator new (allocation_counter.cpp), so they get
+// a binary of their own instead of a mode of search_server.
+
+#include <exception>
+#include <iostream>
+#include <string_view>
+
+#include "test_example_functions.h"
+
+using namespace std;
+
+int main() {
+    try {
+        TestQueryContextDoesNotAllocate();
+        TestPrefixSearchAfterRemoval();
+        TestShardedSearchMatchesSingleServer();
+        TestMemoryStatsCoverAllIndexes();
+        TestRequestQueueWorkersSleepWhenIdle();
+        TestRequestQueueShedsLoadWhenFull();
+        TestStopWordsTable();
+        TestPhraseQueriesMatchBruteForce();
+        TestQueryServiceAnswersInOrder();
+        TestTypoSuggestionsMatchBruteForce();
+        TestBm25OrderingMatchesFormula();
+        TestRequiredWordsMatchIntersection();
+        TestUpdateDocumentMatchesRemoveAndAdd();
+        TestMutationLogRecovery();
+        TestCorpusLoaderMatchesSequentialLoad();
+        TestWorkloadRoundTrip();
+        TestDocumentSetMatchesStdSet();
+        TestMetricsHistogramAndShards();
+        TestSearchCursorPagesMatchFullSearch();
+        TestQueryProfileMatchesBruteForce();
+    }
+    catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    cerr << "Tests passed"sv << endl;
+}
@@ -0,0 +1,1592 @@
+#include "test_example_functions.h"
+
+#include "allocation_counter.h"
+#include "../document_set.h"
+#include "../metrics.h"
+#include "../request_queue.h"
+#include "../search_server.h"
+#include "../sharded_search_server.h"
+#include "../typo_index.h"
+#include "../stop_words.h"
+#include "../mapped_corpus.h"
+#include "../mutation_log.h"
+#include "../workload.h"
+#include "../service/query_service.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+vector<int> GetIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+void CheckIds(vector<int> ids, vector<int> expected, const string& hint) {
+    sort(ids.begin(), ids.end());
+    sort(expected.begin(), expected.end());
+    if (ids != expected) {
+        throw logic_error("Unexpected documents for "s + hint);
+    }
+}
+
+void CheckSameDocuments(const vector<Document>& documents, const vector<Document>& expected, const string& hint) {
+    const bool same = equal(documents.begin(), documents.end(), expected.begin(), expected.end(),
+        [](const Document& lhs, const Document& rhs) {
+            return lhs.id == rhs.id && abs(lhs.relevance - rhs.relevance) < 1e-9 && lhs.rating == rhs.rating;
+        });
+    if (!same) {
+        throw logic_error("Results differ for "s + hint);
+    }
+}
+
+// Words drawn with a skewed distribution from a small vocabulary, so that queries
+// share words with many documents.
+string GenerateText(mt19937& generator, const vector<string>& vocabulary, int max_words) {
+    string text;
+    const int word_count = uniform_int_distribution(1, max_words)(generator);
+    for (int i = 0; i < word_count; ++i) {
+        const size_t index = min(vocabulary.size() - 1, static_cast<size_t>(geometric_distribution(0.15)(generator)));
+        text += (i > 0 ? " "s : ""s) + vocabulary[index];
+    }
+    return text;
+}
+
+// Every result of the query, not only the top ones.
+vector<int> FindAllIds(const SearchServer& search_server, const string& raw_query) {
+    return GetIds(search_server.OpenSearchCursor(raw_query, numeric_limits<int>::max()).NextPage());
+}
+
+// Words over a small alphabet, so that many of them are a few typos apart.
+string GenerateWord(mt19937& generator, int min_length, int max_length) {
+    string word(uniform_int_distribution(min_length, max_length)(generator), 'a');
+    for (char& c : word) {
+        c = static_cast<char>('a' + uniform_int_distribution(0, 3)(generator));
+    }
+    return word;
+}
+
+// Optimal string alignment distance by the full matrix.
+int ComputeTypoDistance(const string& lhs, const string& rhs) {
+    vector<vector<int>> distances(lhs.size() + 1, vector<int>(rhs.size() + 1));
+    for (size_t i = 0; i <= lhs.size(); ++i) {
+        for (size_t j = 0; j <= rhs.size(); ++j) {
+            if (i == 0 || j == 0) {
+                distances[i][j] = static_cast<int>(i + j);
+                continue;
+            }
+            distances[i][j] = min({ distances[i - 1][j] + 1, distances[i][j - 1] + 1,
+                distances[i - 1][j - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1) });
+            if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1]) {
+                distances[i][j] = min(distances[i][j], distances[i - 2][j - 2] + 1);
+            }
+        }
+    }
+    return distances[lhs.size()][rhs.size()];
+}
+
+// Same documents, word frequencies, statuses and ratings, as far as the queries tell.
+void CheckSameServers(const SearchServer& search_server, const SearchServer& expected,
+    const vector<string>& queries, const string& hint) {
+    if (search_server.GetDocumentCount() != expected.GetDocumentCount()
+        || !equal(search_server.begin(), search_server.end(), expected.begin(), expected.end())) {
+        throw logic_error("Different documents "s + hint);
+    }
+    for (const int document_id : expected) {
+        const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+        const auto& expected_word_freqs = expected.GetWordFrequencies(document_id);
+        if (!equal(word_freqs.begin(), word_freqs.end(), expected_word_freqs.begin(), expected_word_freqs.end())) {
+            throw logic_error("Different words of document "s + to_string(document_id) + " "s + hint);
+        }
+    }
+    for (const string& query : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            CheckSameDocuments(search_server.FindTopDocuments(query, status), expected.FindTopDocuments(query, status),
+                query + " "s + hint);
+        }
+    }
+}
+
+// Sends the requests and shuts down the sending side on one thread; on another
+// waits for read_delay, then reads until the service closes the connection.
+string ExchangeWithService(uint16_t port, const string& requests, chrono::milliseconds read_delay) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // A hung service fails the test instead of blocking it.
+    timeval timeout{ 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    string responses;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        thread sender([&] {
+            for (size_t sent_total = 0; sent_total < requests.size();) {
+                const ssize_t sent = send(fd, requests.data() + sent_total, requests.size() - sent_total, MSG_NOSIGNAL);
+                if (sent <= 0) {
+                    break;
+                }
+                sent_total += static_cast<size_t>(sent);
+            }
+            shutdown(fd, SHUT_WR);
+        });
+        this_thread::sleep_for(read_delay);
+        char buffer[64 * 1024];
+        for (ssize_t received = 0; (received = recv(fd, buffer, sizeof(buffer), 0)) > 0;) {
+            responses.append(buffer, static_cast<size_t>(received));
+        }
+        sender.join();
+    }
+    close(fd);
+    return responses;
+}
+
+vector<string> GenerateVocabulary(size_t size) {
+    vector<string> vocabulary;
+    for (size_t i = 0; i < size; ++i) {
+        vocabulary.push_back("w"s + to_string(i));
+    }
+    return vocabulary;
+}
+
+} // namespace
+
+void TestQueryContextDoesNotAllocate() {
+    SearchServer search_server("and in on"s);
+    const vector<string> words = { "cat"s, "dog"s, "tail"s, "collar"s, "city"s, "park"s, "white"s, "black"s };
+    for (int id = 0; id < 200; ++id) {
+        string text;
+        for (size_t i = 0; i < 6; ++i) {
+            text += words[(id * 7 + i * i * 3) % words.size()] + " in "s;
+        }
+        search_server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), { id % 10, 1 });
+    }
+
+    const vector<string> queries = { "cat tail"s, "white dog -collar"s, "park -city -black"s, "on"s, "zebra"s };
+    SearchServer::QueryContext context;
+    vector<Document> documents;
+    vector<string_view> matched_words;
+    const auto run_queries = [&] {
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query, context, documents);
+            const vector<Document> expected = search_server.FindTopDocuments(query);
+            const bool same = equal(documents.begin(), documents.end(), expected.begin(), expected.end(),
+                [](const Document& lhs, const Document& rhs) {
+                    return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+                });
+            if (!same) {
+                throw logic_error("QueryContext results differ for "s + query);
+            }
+            search_server.FindTopDocuments(query, DocumentStatus::BANNED, context, documents);
+            search_server.MatchDocument(query, 3, context, matched_words);
+        }
+    };
+    run_queries();
+
+    size_t allocations = 0;
+    {
+        AllocationCounter counter;
+        for (int i = 0; i < 10; ++i) {
+            for (const string& query : queries) {
+                search_server.FindTopDocuments(query, context, documents);
+                search_server.FindTopDocuments(query, DocumentStatus::BANNED, context, documents);
+                search_server.MatchDocument(query, 3, context, matched_words);
+            }
+        }
+        allocations = counter.GetCount();
+    }
+    if (allocations != 0) {
+        throw logic_error("Warmed-up QueryContext queries allocated "s + to_string(allocations) + " times"s);
+    }
+}
+
+void TestPrefixSearchAfterRemoval() {
+    for (const bool parallel : { false, true }) {
+        SearchServerOptions options;
+        options.max_typo_distance = 1;
+        options.dense_word_min_documents = 2;
+        SearchServer search_server("in"s, options);
+        search_server.AddDocument(1, "cat in city"s, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "car in city"s, DocumentStatus::ACTUAL, { 2 });
+        search_server.AddDocument(3, "cap dog"s, DocumentStatus::ACTUAL, { 3 });
+        const auto remove = [&](int document_id) {
+            if (parallel) {
+                search_server.RemoveDocument(execution::par, document_id);
+            }
+            else {
+                search_server.RemoveDocument(document_id);
+            }
+        };
+        const string policy = parallel ? " after a parallel removal"s : " after a removal"s;
+
+        // Document 1 was the last one with "cat".
+        remove(1);
+        CheckIds(GetIds(search_server.FindTopDocuments("ca*"s)), { 2, 3 }, "ca*"s + policy);
+        CheckIds(GetIds(search_server.FindTopDocuments("cats"s)), {}, "cats"s + policy);
+        CheckIds(GetIds(search_server.FindTopDocuments("cat*"s)), {}, "cat*"s + policy);
+        const auto [words, _] = search_server.MatchDocument("ca* -cit*"s, 3);
+        if (words != vector<string_view>{ "cap"sv }) {
+            throw logic_error("Unexpected matched words"s + policy);
+        }
+
+        // "city" drops below the dense-set threshold, then out of the index.
+        remove(2);
+        CheckIds(GetIds(search_server.FindTopDocuments("ca* -city"s)), { 3 }, "ca* -city"s + policy);
+        search_server.AddDocument(4, "city cab"s, DocumentStatus::ACTUAL, { 4 });
+        CheckIds(GetIds(search_server.FindTopDocuments("ca* -ci*"s)), { 3 }, "ca* -ci*"s + policy);
+        CheckIds(GetIds(search_server.FindTopDocuments("citi"s)), { 4 }, "citi"s + policy);
+    }
+}
+
+void TestShardedSearchMatchesSingleServer() {
+    for (const Scoring scoring : { Scoring::TF_IDF, Scoring::BM25 }) {
+        mt19937 generator(42);
+        const vector<string> vocabulary = GenerateVocabulary(50);
+        vector<string> texts;
+        for (int id = 0; id < 1000; ++id) {
+            texts.push_back(GenerateText(generator, vocabulary, 10));
+        }
+        const auto get_status = [](int id) {
+            return id % 4 == 3 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+        };
+
+        SearchServerOptions options;
+        options.scoring = scoring;
+        SearchServer single("w0"s, options);
+        ShardedSearchServer sharded("w0"s, 4, options);
+        const string hint = scoring == Scoring::BM25 ? " (BM25)"s : ""s;
+        // Ratings are unique, so that the top results have no ties.
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+            single.AddDocument(id, texts[id], get_status(id), { id });
+        }
+        // Concurrent writers, to different shards most of the time.
+        vector<thread> writers;
+        for (int writer = 0; writer < 4; ++writer) {
+            writers.emplace_back([&, writer] {
+                for (int id = writer; id < static_cast<int>(texts.size()); id += 4) {
+                    sharded.AddDocument(id, texts[id], get_status(id), { id });
+                }
+            });
+        }
+        for (thread& writer : writers) {
+            writer.join();
+        }
+        for (int id = 0; id < 1000; id += 7) {
+            single.RemoveDocument(id);
+            sharded.RemoveDocument(id);
+        }
+        if (sharded.GetDocumentCount() != single.GetDocumentCount()) {
+            throw logic_error("Sharded document count differs"s + hint);
+        }
+
+        for (int i = 0; i < 200; ++i) {
+            const string query = GenerateText(generator, vocabulary, 4) + " -"s + vocabulary[i % vocabulary.size()];
+            CheckSameDocuments(sharded.FindTopDocuments(query), single.FindTopDocuments(query), query + hint);
+            CheckSameDocuments(sharded.FindTopDocuments(query, DocumentStatus::IRRELEVANT),
+                single.FindTopDocuments(query, DocumentStatus::IRRELEVANT), query + " (irrelevant)"s + hint);
+            const auto by_rating = [](int, DocumentStatus, int rating) {
+                return rating % 2 == 0;
+            };
+            CheckSameDocuments(sharded.FindTopDocuments(query, by_rating), single.FindTopDocuments(query, by_rating),
+                query + " (even ratings)"s + hint);
+        }
+    }
+}
+
+void TestMemoryStatsCoverAllIndexes() {
+    SearchServerOptions options;
+    options.positional_index = true;
+    options.max_typo_distance = 1;
+    SearchServer search_server("in"s, options);
+    search_server.AddDocument(1, "white cat in white city"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "black dog in city"s, DocumentStatus::ACTUAL, { 2 });
+
+    MemoryStats stats = search_server.GetMemoryStats();
+    // One position list per (word, document) pair; one typo term per word.
+    if (stats.positional_index.objects != 6 || stats.positional_index.bytes == 0) {
+        throw logic_error("Positional index memory is not reported"s);
+    }
+    if (stats.typo_index.objects != 5 || stats.typo_index.bytes == 0) {
+        throw logic_error("Typo index memory is not reported"s);
+    }
+    if (stats.GetTotalBytes() < stats.positional_index.bytes + stats.typo_index.bytes + stats.inverted_index.bytes) {
+        throw logic_error("Total memory misses a structure"s);
+    }
+
+    search_server.RemoveDocument(1);
+    search_server.RemoveDocument(execution::par, 2);
+    stats = search_server.GetMemoryStats();
+    if (stats.positional_index.objects != 0 || stats.positional_index.bytes != 0 || stats.typo_index.objects != 0) {
+        throw logic_error("Removed documents still hold index memory"s);
+    }
+}
+
+void TestRequestQueueWorkersSleepWhenIdle() {
+    mt19937 generator(7);
+    const vector<string> vocabulary = GenerateVocabulary(30);
+    SearchServer search_server(""s);
+    for (int id = 0; id < 500; ++id) {
+        search_server.AddDocument(id, GenerateText(generator, vocabulary, 8), DocumentStatus::ACTUAL, { id });
+    }
+
+    RequestQueueOptions options;
+    options.workers = 4;
+    RequestQueue request_queue(search_server, options);
+    const auto submit_and_check = [&] {
+        vector<string> queries;
+        vector<future<vector<Document>>> results;
+        for (int i = 0; i < 100; ++i) {
+            queries.push_back(GenerateText(generator, vocabulary, 3));
+            results.push_back(request_queue.Submit(queries.back()));
+        }
+        for (size_t i = 0; i < queries.size(); ++i) {
+            CheckSameDocuments(results[i].get(), search_server.FindTopDocuments(queries[i]), queries[i]);
+        }
+    };
+
+    submit_and_check();
+    // Long enough for every worker to finish spinning and park.
+    this_thread::sleep_for(chrono::milliseconds(50));
+    const RequestQueueStats idle_start = request_queue.GetStats();
+    this_thread::sleep_for(chrono::milliseconds(200));
+    const RequestQueueStats idle_end = request_queue.GetStats();
+    // A worker that wakes up without work spins again and parks once more.
+    if (idle_start.parked_workers != options.workers || idle_end.parked_workers != options.workers
+        || idle_end.worker_parks != idle_start.worker_parks) {
+        throw logic_error("Idle request queue workers woke up: "s + to_string(idle_end.parked_workers) + " parked, "s
+            + to_string(idle_end.worker_parks - idle_start.worker_parks) + " parks in 200 ms"s);
+    }
+    // Parked workers wake up for new requests.
+    submit_and_check();
+}
+
+void TestStopWordsTable() {
+    constexpr auto static_stop_words = MakeStaticStopWords<4>({ "a"sv, "in"sv, "on"sv, "the"sv });
+    static_assert(static_stop_words.Contains("in"sv) && !static_stop_words.Contains("at"sv));
+
+    try {
+        const array<string_view, 3> words = { "in"sv, "the"sv, "in"sv };
+        MakeStaticStopWords(words);
+        throw logic_error("Duplicate stop words accepted"s);
+    }
+    catch (const invalid_argument& error) {
+        if (error.what() != "Stop words contain duplicates"s) {
+            throw logic_error("Unexpected error for duplicate stop words: "s + error.what());
+        }
+    }
+
+    set<string, less<>> words;
+    for (int i = 0; i < 50000; ++i) {
+        words.insert("stop"s + to_string(i));
+    }
+    const auto start = chrono::steady_clock::now();
+    const StopWords stop_words(words);
+    if (chrono::steady_clock::now() - start > chrono::seconds(1)) {
+        throw logic_error("Building a large stop-word table is too slow"s);
+    }
+    for (int i = 0; i < 100000; ++i) {
+        if (stop_words.Contains("stop"s + to_string(i)) != (i < 50000)) {
+            throw logic_error("Wrong stop-word membership for stop"s + to_string(i));
+        }
+    }
+}
+
+void TestPhraseQueriesMatchBruteForce() {
+    mt19937 generator(11);
+    const vector<string> vocabulary = GenerateVocabulary(8);
+    SearchServerOptions options;
+    options.positional_index = true;
+    SearchServer index_server("w5"s, options);
+    SearchServer rescan_server("w5"s);
+    map<int, string> texts;
+    for (int id = 0; id < 300; ++id) {
+        texts[id] = GenerateText(generator, vocabulary, 12);
+        index_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+        rescan_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+    }
+    for (int id = 0; id < 300; id += 5) {
+        if (id % 2 == 0) {
+            index_server.RemoveDocument(execution::par, id);
+        }
+        else {
+            index_server.RemoveDocument(id);
+        }
+        rescan_server.RemoveDocument(id);
+        texts.erase(id);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        // Stop words stay out of the phrases but keep their positions in the documents.
+        vector<string> phrase(uniform_int_distribution(2, 3)(generator));
+        for (string& word : phrase) {
+            word = vocabulary[uniform_int_distribution(0, 4)(generator)];
+        }
+        const string minus_word = i % 2 == 0 ? ""s : vocabulary[6];
+        string query = "\""s;
+        for (const string& word : phrase) {
+            query += (query.size() > 1 ? " "s : ""s) + word;
+        }
+        query += "\""s + (minus_word.empty() ? ""s : " -"s + minus_word);
+
+        vector<int> expected;
+        for (const auto& [id, text] : texts) {
+            const vector<string_view> words = SplitIntoWords(text);
+            const bool excluded = !minus_word.empty() && count(words.begin(), words.end(), minus_word) > 0;
+            bool matched = false;
+            for (size_t start = 0; !matched && start + phrase.size() <= words.size(); ++start) {
+                matched = equal(phrase.begin(), phrase.end(), words.begin() + start);
+            }
+            if (matched && !excluded) {
+                expected.push_back(id);
+            }
+        }
+
+        CheckIds(FindAllIds(index_server, query), expected, query);
+        CheckIds(FindAllIds(rescan_server, query), expected, query + " (rescan)"s);
+        CheckSameDocuments(index_server.FindTopDocuments(execution::par, query),
+            rescan_server.FindTopDocuments(query), query);
+        const int document_id = next(texts.begin(), i % texts.size())->first;
+        const bool expected_match = binary_search(expected.begin(), expected.end(), document_id);
+        if (get<0>(index_server.MatchDocument(query, document_id)).empty() == expected_match) {
+            throw logic_error("Unexpected phrase match for "s + query);
+        }
+    }
+}
+
+void TestQueryServiceAnswersInOrder() {
+    SearchServer search_server("in"s);
+    QueryService service(search_server, 0);
+    thread service_thread([&service] { service.Run(); });
+
+    // Sent at once, so that reads and writes arrive in one loop iteration and the
+    // writes have to split the read batch.
+    const string requests =
+        "ADD 1 ACTUAL 5,7 white cat in city\n"
+        "ADD 2 BANNED 1 black dog\n"
+        "ADD 3 ACTUAL 3 cat and dog in city park\n"
+        "FIND cat city\n"
+        "MATCH 2 dog -cat\n"
+        "REMOVE 1\n"
+        "FIND cat city\n"
+        "ADD 4 ACTUAL fluffy cat\n"
+        "COUNT\n"
+        "MEMORY\n"s;
+    const string responses = ExchangeWithService(service.GetPort(), requests, chrono::milliseconds(0));
+    // Far more answers than the socket buffers hold, to a client that reads only
+    // after it has stopped sending: the service has to keep them until they are sent.
+    string memory_requests;
+    for (int i = 0; i < 100000; ++i) {
+        memory_requests += "MEMORY\n"s;
+    }
+    const string memory_responses = ExchangeWithService(service.GetPort(), memory_requests, chrono::milliseconds(200));
+    service.Stop();
+    service_thread.join();
+    if (count(memory_responses.begin(), memory_responses.end(), '\n') != 100000) {
+        throw logic_error("Service dropped answers to a half-closed connection"s);
+    }
+
+    // The same calls on a server of our own.
+    SearchServer expected_server("in"s);
+    const auto format_documents = [](const vector<Document>& documents) {
+        string response = "OK "s + to_string(documents.size());
+        char buffer[64];
+        for (const Document& document : documents) {
+            snprintf(buffer, sizeof(buffer), " %d %.6g %d", document.id, document.relevance, document.rating);
+            response += buffer;
+        }
+        return response;
+    };
+    string expected = "OK\nOK\nOK\n"s;
+    expected_server.AddDocument(1, "white cat in city"s, DocumentStatus::ACTUAL, { 5, 7 });
+    expected_server.AddDocument(2, "black dog"s, DocumentStatus::BANNED, { 1 });
+    expected_server.AddDocument(3, "cat and dog in city park"s, DocumentStatus::ACTUAL, { 3 });
+    expected += format_documents(expected_server.FindTopDocuments("cat city"s)) + "\n"s;
+    expected += "OK BANNED dog\nOK\n"s;
+    expected_server.RemoveDocument(1);
+    expected += format_documents(expected_server.FindTopDocuments("cat city"s)) + "\n"s;
+    expected += "ERR invalid number fluffy\nERR unknown command COUNT\n"s;
+
+    if (responses.substr(0, expected.size()) != expected) {
+        throw logic_error("Unexpected service responses:\n"s + responses);
+    }
+    if (responses.substr(expected.size(), 4) != "OK {"s || responses.back() != '\n') {
+        throw logic_error("Unexpected MEMORY response:\n"s + responses.substr(expected.size()));
+    }
+}
+
+void TestTypoSuggestionsMatchBruteForce() {
+    mt19937 generator(5);
+    set<string> dictionary;
+    while (dictionary.size() < 2000) {
+        dictionary.insert(GenerateWord(generator, 2, 10));
+    }
+    TypoIndex typo_index;
+    for (const string& term : dictionary) {
+        typo_index.AddTerm(term);
+    }
+    // Every third term leaves again.
+    set<string> terms = dictionary;
+    int index = 0;
+    for (const string& term : dictionary) {
+        if (index++ % 3 == 0) {
+            typo_index.RemoveTerm(term);
+            terms.erase(term);
+        }
+    }
+    if (typo_index.GetTermCount() != terms.size()) {
+        throw logic_error("Unexpected typo index term count"s);
+    }
+
+    vector<pair<string_view, int>> found;
+    for (int i = 0; i < 500; ++i) {
+        const string word = GenerateWord(generator, 1, 11);
+        for (const int max_distance : { 1, 2 }) {
+            const int allowed = min(max_distance, TypoIndex::GetAllowedDistance(word.size()));
+            vector<pair<string, int>> expected;
+            for (const string& term : terms) {
+                const int distance = ComputeTypoDistance(word, term);
+                if (distance > 0 && distance <= allowed) {
+                    expected.emplace_back(term, distance);
+                }
+            }
+            found.clear();
+            typo_index.FindTerms(word, max_distance, found);
+            vector<pair<string, int>> actual(found.begin(), found.end());
+            sort(actual.begin(), actual.end());
+            if (actual != expected) {
+                throw logic_error("Unexpected typo suggestions for "s + word);
+            }
+        }
+    }
+
+    // A suggestion scores as the exact word times typo_penalty per typo.
+    SearchServerOptions options;
+    options.max_typo_distance = 2;
+    SearchServer search_server("and"s, options);
+    search_server.AddDocument(1, "kitten and sitting"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "mitten"s, DocumentStatus::ACTUAL, { 2 });
+    search_server.AddDocument(3, "bitten dog"s, DocumentStatus::ACTUAL, { 3 });
+    search_server.AddDocument(4, "dog"s, DocumentStatus::ACTUAL, { 4 });
+    const vector<Document> exact = search_server.FindTopDocuments("sitting"s);
+    const vector<Document> typo = search_server.FindTopDocuments("siting"s);
+    if (GetIds(exact) != vector<int>{ 1 } || GetIds(typo) != vector<int>{ 1 }
+        || abs(typo[0].relevance - exact[0].relevance * options.typo_penalty) > 1e-9) {
+        throw logic_error("Unexpected results for a one-typo query"s);
+    }
+    const vector<Document> two_typos = search_server.FindTopDocuments("sitinq"s);
+    if (GetIds(two_typos) != vector<int>{ 1 }
+        || abs(two_typos[0].relevance - exact[0].relevance * options.typo_penalty * options.typo_penalty) > 1e-9) {
+        throw logic_error("Unexpected results for a two-typo query"s);
+    }
+    // Five letters allow one typo: "mitten" and "bitten" are two away from "kiten".
+    CheckIds(GetIds(search_server.FindTopDocuments("kiten"s)), { 1 }, "kiten"s);
+    if (get<0>(search_server.MatchDocument("kiten dgo"s, 3)) != vector<string_view>{ "dog"sv }) {
+        throw logic_error("Unexpected matched words for a typo query"s);
+    }
+}
+
+void TestBm25OrderingMatchesFormula() {
+    mt19937 generator(3);
+    const vector<string> vocabulary = GenerateVocabulary(20);
+    SearchServerOptions options;
+    options.scoring = Scoring::BM25;
+    SearchServer search_server("w2"s, options);
+    map<int, vector<string_view>> documents;
+    vector<string> texts;
+    for (int id = 0; id < 400; ++id) {
+        texts.push_back(GenerateText(generator, vocabulary, 20));
+    }
+    for (int id = 0; id < 400; ++id) {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+        documents[id] = SplitIntoWords(texts[id]);
+        documents[id].erase(remove(documents[id].begin(), documents[id].end(), "w2"sv), documents[id].end());
+    }
+
+    const auto check_queries = [&](const string& hint) {
+        double total_length = 0;
+        for (const auto& [_, words] : documents) {
+            total_length += words.size();
+        }
+        const double average_length = total_length / documents.size();
+        for (int i = 0; i < 50; ++i) {
+            const string query = GenerateText(generator, vocabulary, 3) + " -"s + vocabulary[10 + i % 10];
+            const vector<string_view> query_words = SplitIntoWords(query);
+            set<string_view> plus_words(query_words.begin(), prev(query_words.end()));
+            plus_words.erase("w2"sv);
+            const string_view minus_word = query_words.back().substr(1);
+
+            vector<Document> expected;
+            for (const auto& [id, words] : documents) {
+                if (count(words.begin(), words.end(), minus_word) > 0) {
+                    continue;
+                }
+                double relevance = 0;
+                bool matched = false;
+                for (const string_view word : plus_words) {
+                    const double occurrences = static_cast<double>(count(words.begin(), words.end(), word));
+                    if (occurrences == 0) {
+                        continue;
+                    }
+                    matched = true;
+                    const double document_freq = static_cast<double>(count_if(documents.begin(), documents.end(),
+                        [word](const auto& document) {
+                            return count(document.second.begin(), document.second.end(), word) > 0;
+                        }));
+                    const double inverse_document_freq
+                        = log(1 + (documents.size() - document_freq + 0.5) / (document_freq + 0.5));
+                    const double norm = options.bm25_k1
+                        * (1 - options.bm25_b + options.bm25_b * words.size() / average_length);
+                    relevance += inverse_document_freq * occurrences * (options.bm25_k1 + 1) / (occurrences + norm);
+                }
+                if (matched) {
+                    expected.push_back({ id, relevance, id });
+                }
+            }
+            sort(expected.begin(), expected.end(), SearchServer::IsMoreRelevant);
+
+            vector<Document> all = search_server.OpenSearchCursor(query, numeric_limits<int>::max()).NextPage();
+            sort(all.begin(), all.end(), [](const Document& lhs, const Document& rhs) { return lhs.id < rhs.id; });
+            vector<Document> expected_by_id = expected;
+            sort(expected_by_id.begin(), expected_by_id.end(),
+                [](const Document& lhs, const Document& rhs) { return lhs.id < rhs.id; });
+            CheckSameDocuments(all, expected_by_id, query + hint);
+
+            expected.resize(min<size_t>(expected.size(), MAX_RESULT_DOCUMENT_COUNT));
+            CheckSameDocuments(search_server.FindTopDocuments(query), expected, query + hint);
+            CheckSameDocuments(search_server.FindTopDocuments(execution::par, query), expected,
+                query + hint + " (parallel)"s);
+        }
+    };
+    check_queries(""s);
+
+    // Document frequencies and the average length change with removals.
+    for (int id = 0; id < 400; id += 3) {
+        search_server.RemoveDocument(id);
+        documents.erase(id);
+    }
+    check_queries(" after removals"s);
+}
+
+void TestRequiredWordsMatchIntersection() {
+    mt19937 generator(17);
+    const vector<string> vocabulary = GenerateVocabulary(25);
+    SearchServerOptions options;
+    options.dense_word_min_documents = 16;
+    SearchServer search_server("w4"s, options);
+    options.conjunctive_queries = true;
+    SearchServer conjunctive_server("w4"s, options);
+    map<int, vector<string_view>> documents;
+    vector<string> texts;
+    for (int id = 0; id < 600; ++id) {
+        texts.push_back(GenerateText(generator, vocabulary, 12));
+    }
+    for (int id = 0; id < 600; ++id) {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+        conjunctive_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+        documents[id] = SplitIntoWords(texts[id]);
+    }
+    for (int id = 0; id < 600; id += 7) {
+        search_server.RemoveDocument(id);
+        conjunctive_server.RemoveDocument(execution::par, id);
+        documents.erase(id);
+    }
+
+    for (int i = 0; i < 300; ++i) {
+        const string text = GenerateText(generator, vocabulary, 4);
+        const vector<string_view> words = SplitIntoWords(text);
+        const string minus_word = i % 3 == 0 ? vocabulary[uniform_int_distribution(5, 14)(generator)] : ""s;
+        // The same words with every one required, and with a random non-empty subset.
+        string required_query;
+        string mixed_query;
+        vector<string_view> required_words;
+        const size_t always_required = uniform_int_distribution<size_t>(0, words.size() - 1)(generator);
+        for (size_t j = 0; j < words.size(); ++j) {
+            const bool required = j == always_required || uniform_int_distribution(0, 1)(generator) == 1;
+            const string separator = j > 0 ? " "s : ""s;
+            required_query += separator + "+"s + string(words[j]);
+            mixed_query += separator + (required ? "+"s : ""s) + string(words[j]);
+            if (required && words[j] != "w4"sv) {
+                required_words.push_back(words[j]);
+            }
+        }
+        string query = text;
+        if (!minus_word.empty()) {
+            query += " -"s + minus_word;
+            required_query += " -"s + minus_word;
+            mixed_query += " -"s + minus_word;
+        }
+
+        const auto intersect = [&](const vector<string_view>& required) {
+            vector<int> ids;
+            for (const auto& [id, document_words] : documents) {
+                const auto contains = [&document_words](string_view word) {
+                    return find(document_words.begin(), document_words.end(), word) != document_words.end();
+                };
+                const bool matches = required.empty()
+                    ? any_of(words.begin(), words.end(), [&](string_view word) { return word != "w4"sv && contains(word); })
+                    : all_of(required.begin(), required.end(), contains);
+                if (matches && (minus_word.empty() || !contains(minus_word))) {
+                    ids.push_back(id);
+                }
+            }
+            return ids;
+        };
+        vector<string_view> all_words;
+        copy_if(words.begin(), words.end(), back_inserter(all_words), [](string_view word) { return word != "w4"sv; });
+        const vector<int> expected_all = intersect(all_words);
+        const vector<int> expected_mixed = intersect(required_words);
+
+        CheckIds(FindAllIds(conjunctive_server, query), expected_all, query + " (conjunctive)"s);
+        CheckIds(FindAllIds(search_server, required_query), expected_all, required_query);
+        CheckIds(FindAllIds(search_server, mixed_query), expected_mixed, mixed_query);
+        CheckSameDocuments(conjunctive_server.FindTopDocuments(query), search_server.FindTopDocuments(required_query),
+            query + " (conjunctive)"s);
+        CheckSameDocuments(search_server.FindTopDocuments(execution::par, mixed_query),
+            search_server.FindTopDocuments(mixed_query), mixed_query + " (parallel)"s);
+
+        const int document_id = next(documents.begin(), i % documents.size())->first;
+        const bool expected_match = binary_search(expected_mixed.begin(), expected_mixed.end(), document_id);
+        if (get<0>(search_server.MatchDocument(mixed_query, document_id)).empty() == expected_match) {
+            throw logic_error("Unexpected match for "s + mixed_query);
+        }
+    }
+}
+
+void TestUpdateDocumentMatchesRemoveAndAdd() {
+    for (const Scoring scoring : { Scoring::TF_IDF, Scoring::BM25 }) {
+        mt19937 generator(scoring == Scoring::BM25 ? 23 : 29);
+        const vector<string> vocabulary = GenerateVocabulary(60);
+        SearchServerOptions options;
+        options.positional_index = true;
+        options.max_typo_distance = 1;
+        options.dense_word_min_documents = 5;
+        options.scoring = scoring;
+        SearchServer updated_server("w3"s, options);
+        SearchServer replaced_server("w3"s, options);
+        for (int id = 0; id < 200; ++id) {
+            const string text = GenerateText(generator, vocabulary, 12);
+            updated_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+            replaced_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+        }
+
+        map<int, string> texts;
+        for (int i = 0; i < 2000; ++i) {
+            const int id = uniform_int_distribution(0, 199)(generator);
+            string text = GenerateText(generator, vocabulary, 12);
+            // Words unique to one update come and go from the typo index.
+            if (i % 5 == 0) {
+                text += " x"s + to_string(i);
+            }
+            const auto status = static_cast<DocumentStatus>(uniform_int_distribution(0, 2)(generator));
+            const vector<int> ratings = { i % 10 };
+            updated_server.UpdateDocument(id, text, status, ratings);
+            replaced_server.RemoveDocument(id);
+            replaced_server.AddDocument(id, text, status, ratings);
+            texts[id] = text;
+        }
+
+        const string hint = scoring == Scoring::BM25 ? " (BM25)"s : " (TF-IDF)"s;
+        for (const auto& [id, _] : texts) {
+            const auto& updated_freqs = updated_server.GetWordFrequencies(id);
+            const auto& replaced_freqs = replaced_server.GetWordFrequencies(id);
+            if (!equal(updated_freqs.begin(), updated_freqs.end(), replaced_freqs.begin(), replaced_freqs.end())) {
+                throw logic_error("Word frequencies differ for document "s + to_string(id) + hint);
+            }
+        }
+        const MemoryStats updated_stats = updated_server.GetMemoryStats();
+        const MemoryStats replaced_stats = replaced_server.GetMemoryStats();
+        if (updated_stats.inverted_index.objects != replaced_stats.inverted_index.objects
+            || updated_stats.positional_index.objects != replaced_stats.positional_index.objects
+            || updated_stats.typo_index.objects != replaced_stats.typo_index.objects
+            || updated_server.GetPositionalIndexSize() != replaced_server.GetPositionalIndexSize()) {
+            throw logic_error("Index sizes differ"s + hint);
+        }
+        // Replaced texts are released: both servers hold one text per document.
+        if (updated_stats.document_text.bytes != replaced_stats.document_text.bytes
+            || updated_stats.document_text.objects != 200) {
+            throw logic_error("Updated server holds "s + to_string(updated_stats.document_text.objects) + " texts"s + hint);
+        }
+
+        for (int i = 0; i < 300; ++i) {
+            const string& word = vocabulary[uniform_int_distribution(0, 59)(generator)];
+            const vector<string> queries = {
+                GenerateText(generator, vocabulary, 4) + " -"s + vocabulary[i % 60],
+                "\""s + GenerateText(generator, vocabulary, 2) + "\" "s + word,
+                "+w0 "s + word.substr(0, 2) + "*"s,
+                // One typo away from the word and from the update-only words.
+                "x"s + to_string(i * 5 + 1) + " "s + word + "z"s,
+            };
+            for (const string& query : queries) {
+                for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+                    CheckSameDocuments(updated_server.FindTopDocuments(query, status),
+                        replaced_server.FindTopDocuments(query, status), query + hint);
+                }
+                CheckIds(FindAllIds(updated_server, query), FindAllIds(replaced_server, query), query + hint);
+                const int document_id = uniform_int_distribution(0, 199)(generator);
+                if (updated_server.MatchDocument(query, document_id) != replaced_server.MatchDocument(query, document_id)) {
+                    throw logic_error("Matched words differ for "s + query + hint);
+                }
+            }
+        }
+
+        // Removing every document releases the texts and the words of the inverted index.
+        for (int id = 0; id < 200; ++id) {
+            updated_server.RemoveDocument(id);
+        }
+        const MemoryStats empty_stats = updated_server.GetMemoryStats();
+        if (empty_stats.document_text.bytes != 0 || empty_stats.inverted_index.bytes != 0) {
+            throw logic_error("An empty server holds "s + to_string(empty_stats.document_text.bytes) + " bytes of texts and "s
+                + to_string(empty_stats.inverted_index.bytes) + " bytes of inverted index"s + hint);
+        }
+    }
+}
+
+void TestMutationLogRecovery() {
+    const string path = (filesystem::temp_directory_path() / "search_server_test_mutation.log").string();
+    filesystem::remove(path);
+    mt19937 generator(31);
+    const vector<string> vocabulary = GenerateVocabulary(30);
+    vector<string> queries;
+    for (int i = 0; i < 30; ++i) {
+        queries.push_back(GenerateText(generator, vocabulary, 3));
+    }
+
+    // Mutations of a few ids, so that documents are replaced and removed repeatedly.
+    struct Mutation {
+        bool add;
+        int id;
+        string text;
+        DocumentStatus status;
+        vector<int> ratings;
+    };
+    vector<Mutation> mutations;
+    for (int i = 0; i < 120; ++i) {
+        const int id = uniform_int_distribution(0, 29)(generator);
+        if (i % 4 == 3) {
+            mutations.push_back({ false, id, ""s, DocumentStatus::ACTUAL, {} });
+        }
+        else {
+            mutations.push_back({ true, id, GenerateText(generator, vocabulary, 10),
+                static_cast<DocumentStatus>(i % 3), { i, -i, 7 } });
+        }
+    }
+    const auto append = [](MutationLog& mutation_log, const Mutation& mutation) {
+        if (mutation.add) {
+            mutation_log.AppendAdd(mutation.id, mutation.text, mutation.status, mutation.ratings);
+        }
+        else {
+            mutation_log.AppendRemove(mutation.id);
+        }
+    };
+    const auto make_expected = [&](size_t count) {
+        auto search_server = make_unique<SearchServer>("w1"s);
+        for (size_t i = 0; i < count; ++i) {
+            search_server->RemoveDocument(mutations[i].id);
+            if (mutations[i].add) {
+                search_server->AddDocument(mutations[i].id, mutations[i].text, mutations[i].status, mutations[i].ratings);
+            }
+        }
+        return search_server;
+    };
+
+    // Record starts, taken from the file size after every synced append.
+    vector<size_t> offsets;
+    {
+        MutationLog mutation_log(path);
+        for (const Mutation& mutation : mutations) {
+            offsets.push_back(filesystem::file_size(path));
+            append(mutation_log, mutation);
+            mutation_log.Sync();
+        }
+    }
+    const size_t log_size = filesystem::file_size(path);
+    MutationLogReplay inspection = InspectMutationLog(path);
+    if (inspection.records != mutations.size() || inspection.discarded_bytes != 0
+        || inspection.added != static_cast<size_t>(count_if(mutations.begin(), mutations.end(),
+            [](const Mutation& mutation) { return mutation.add; }))) {
+        throw logic_error("Unexpected inspection of a complete log"s);
+    }
+
+    // Replay is idempotent, also on top of documents the server already has.
+    const auto expected = make_expected(mutations.size());
+    SearchServer replayed("w1"s);
+    replayed.AddDocument(0, "w0 w2"s, DocumentStatus::ACTUAL, { 1 });
+    replayed.AddDocument(100, "w3 w4"s, DocumentStatus::ACTUAL, { 1 });
+    ReplayMutationLog(replayed, path);
+    replayed.RemoveDocument(100);
+    CheckSameServers(replayed, *expected, queries, "after a replay"s);
+    ReplayMutationLog(replayed, path);
+    CheckSameServers(replayed, *expected, queries, "after a second replay"s);
+
+    // Truncation replaces the file, so the texts mapped by the replay stay readable.
+    {
+        MutationLog mutation_log(path);
+        mutation_log.Truncate();
+    }
+    if (InspectMutationLog(path).records != 0 || filesystem::file_size(path) != 8) {
+        throw logic_error("Truncated log is not empty"s);
+    }
+    CheckSameServers(replayed, *expected, queries, "after truncating the log"s);
+
+    const auto write_log = [&] {
+        filesystem::remove(path);
+        MutationLog mutation_log(path);
+        for (const Mutation& mutation : mutations) {
+            append(mutation_log, mutation);
+        }
+    };
+
+    // A torn last record is reported, then cut off when the log is opened again.
+    write_log();
+    filesystem::resize_file(path, log_size - 3);
+    inspection = InspectMutationLog(path);
+    if (inspection.records != mutations.size() - 1 || inspection.discarded_bytes != log_size - 3 - offsets.back()) {
+        throw logic_error("Unexpected inspection of a torn log"s);
+    }
+    {
+        MutationLog mutation_log(path);
+        if (filesystem::file_size(path) != offsets.back()) {
+            throw logic_error("Torn tail was not cut off"s);
+        }
+        append(mutation_log, mutations.back());
+    }
+    if (filesystem::file_size(path) != log_size) {
+        throw logic_error("Unexpected size of a repaired log"s);
+    }
+    SearchServer repaired("w1"s);
+    ReplayMutationLog(repaired, path);
+    CheckSameServers(repaired, *expected, queries, "after repairing a torn log"s);
+
+    // A corrupt payload byte ends the log at its record.
+    write_log();
+    const size_t corrupt_record = 70;
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.seekg(static_cast<streamoff>(offsets[corrupt_record] + 9));
+        const char byte = static_cast<char>(file.get());
+        file.seekp(static_cast<streamoff>(offsets[corrupt_record] + 9));
+        file.put(static_cast<char>(byte ^ 0x20));
+    }
+    inspection = InspectMutationLog(path);
+    if (inspection.records != corrupt_record || inspection.discarded_bytes != log_size - offsets[corrupt_record]) {
+        throw logic_error("Corrupt record was not detected"s);
+    }
+    SearchServer truncated("w1"s);
+    ReplayMutationLog(truncated, path);
+    CheckSameServers(truncated, *make_expected(corrupt_record), queries, "after a corrupt record"s);
+
+    // A crash while the log was created can leave part of the magic.
+    {
+        ofstream(path, ios::binary | ios::trunc) << "SSML"s;
+    }
+    if (InspectMutationLog(path).records != 0) {
+        throw logic_error("Unexpected records in a partial magic"s);
+    }
+    {
+        MutationLog mutation_log(path);
+        mutation_log.AppendRemove(1);
+    }
+    if (InspectMutationLog(path).records != 1) {
+        throw logic_error("Log with a partial magic was not reinitialized"s);
+    }
+    {
+        ofstream(path, ios::binary | ios::trunc) << "NOT A LOG"s;
+    }
+    try {
+        InspectMutationLog(path);
+        throw logic_error("Foreign file accepted as a log"s);
+    }
+    catch (const runtime_error&) {
+    }
+
+    // Once a write fails, appends report the error instead of losing records.
+    filesystem::remove(path);
+    {
+        MutationLogOptions options;
+        options.wait_for_commit = true;
+        MutationLog mutation_log(path, options);
+        rlimit limit{};
+        getrlimit(RLIMIT_FSIZE, &limit);
+        const rlimit small_limit{ 4096, limit.rlim_max };
+        const auto previous_handler = signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &small_limit);
+        int failures = 0;
+        for (int i = 0; i < 2; ++i) {
+            try {
+                mutation_log.AppendAdd(i, string(8192, 'a'), DocumentStatus::ACTUAL, { 1 });
+            }
+            catch (const runtime_error& error) {
+                failures += string(error.what()).find("Cannot write"s) == 0;
+            }
+        }
+        setrlimit(RLIMIT_FSIZE, &limit);
+        signal(SIGXFSZ, previous_handler);
+        if (failures != 2) {
+            throw logic_error("Failed log writes were not reported"s);
+        }
+    }
+    filesystem::remove(path);
+}
+
+void TestCorpusLoaderMatchesSequentialLoad() {
+    mt19937 generator(37);
+    const vector<string> vocabulary = GenerateVocabulary(40);
+    const vector<string> status_names = { "ACTUAL"s, "IRRELEVANT"s, "BANNED"s, "REMOVED"s };
+    vector<CorpusRecord> expected;
+    vector<string> texts(3000);
+    string data;
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        texts[id] = GenerateText(generator, vocabulary, 15);
+        const int status = uniform_int_distribution(0, 3)(generator);
+        const vector<int> ratings = { id % 11 - 5, id, -id };
+        expected.push_back({ id * 3, static_cast<DocumentStatus>(status), ratings, texts[id] });
+        data += to_string(id * 3) + "\t"s + status_names[status] + "\t"s + to_string(ratings[0]) + " "s
+            + to_string(ratings[1]) + "  "s + to_string(ratings[2]) + "\t"s + texts[id];
+        // Mixed line endings and empty lines; the last line has no line break.
+        if (id + 1 < static_cast<int>(texts.size())) {
+            data += id % 3 == 0 ? "\r\n"s : "\n"s;
+            if (id % 17 == 0) {
+                data += "\n"s;
+            }
+        }
+    }
+
+    // The chunk count is capped at one chunk per 4096 bytes; the bounds fall mid-line.
+    for (const size_t chunk_count : { 1, 3, 16, 1000 }) {
+        const vector<CorpusRecord> records = ParseCorpus(data, chunk_count);
+        const bool same = equal(records.begin(), records.end(), expected.begin(), expected.end(),
+            [](const CorpusRecord& lhs, const CorpusRecord& rhs) {
+                return lhs.id == rhs.id && lhs.status == rhs.status && lhs.ratings == rhs.ratings && lhs.text == rhs.text;
+            });
+        if (!same) {
+            throw logic_error("Unexpected corpus records for "s + to_string(chunk_count) + " chunks"s);
+        }
+    }
+
+    // The offset of a malformed line is reported from whichever chunk finds it.
+    const vector<string> malformed_lines = { "7\tACTUAL\tx\tw1"s, "7\tOPEN\t1\tw1"s, "7\tACTUAL"s, "7\tACTUAL\t\tw1"s };
+    for (const string& malformed_line : malformed_lines) {
+        const size_t offset = data.find('\n', data.size() * 2 / 3) + 1;
+        const string malformed_data = data.substr(0, offset) + malformed_line + "\n"s + data.substr(offset);
+        for (const size_t chunk_count : { 1, 16 }) {
+            try {
+                ParseCorpus(malformed_data, chunk_count);
+                throw logic_error("Malformed corpus line accepted: "s + malformed_line);
+            }
+            catch (const invalid_argument& error) {
+                if (string(error.what()).find("Corpus line at offset "s + to_string(offset) + ":"s) != 0) {
+                    throw logic_error("Wrong location of a malformed corpus line: "s + error.what());
+                }
+            }
+        }
+    }
+
+    // The texts stay mapped after the file is gone: the server keeps the mapping alive.
+    const string path = (filesystem::temp_directory_path() / "search_server_test_corpus.tsv").string();
+    {
+        ofstream(path, ios::binary | ios::trunc) << data;
+    }
+    SearchServer loaded("w2"s);
+    if (LoadCorpus(loaded, path, 16) != expected.size()) {
+        throw logic_error("Unexpected number of loaded documents"s);
+    }
+    filesystem::remove(path);
+    SearchServer added("w2"s);
+    for (const CorpusRecord& record : expected) {
+        added.AddDocument(record.id, record.text, record.status, record.ratings);
+    }
+    vector<string> queries;
+    for (int i = 0; i < 50; ++i) {
+        queries.push_back(GenerateText(generator, vocabulary, 4));
+    }
+    CheckSameServers(loaded, added, queries, "after loading the corpus"s);
+}
+
+void TestRequestQueueShedsLoadWhenFull() {
+    mt19937 generator(30);
+    const vector<string> vocabulary = GenerateVocabulary(20);
+    SearchServer search_server(""s);
+    for (int id = 0; id < 20000; ++id) {
+        search_server.AddDocument(id, GenerateText(generator, vocabulary, 10), DocumentStatus::ACTUAL, { id });
+    }
+
+    RequestQueueOptions options;
+    options.capacity = 2;
+    options.workers = 1;
+    options.bucket_duration = chrono::milliseconds(100);
+    options.bucket_count = 3;
+    RequestQueue request_queue(search_server, options);
+    // Every query scores most of the corpus: submitting is much faster than answering.
+    vector<string> queries;
+    vector<optional<future<vector<Document>>>> results;
+    for (int i = 0; i < 200; ++i) {
+        queries.push_back(GenerateText(generator, vocabulary, 6) + (i % 4 == 0 ? " -w0"s : ""s) + " missing"s);
+        if (i % 10 == 0) {
+            queries.back() = "missing"s;
+        }
+        results.push_back(request_queue.TrySubmit(queries.back()));
+    }
+
+    uint64_t accepted = 0;
+    uint64_t no_result = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (!results[i]) {
+            continue;
+        }
+        const vector<Document> documents = results[i]->get();
+        CheckSameDocuments(documents, search_server.FindTopDocuments(queries[i]), queries[i]);
+        ++accepted;
+        no_result += documents.empty() ? 1 : 0;
+    }
+    const RequestQueueStats stats = request_queue.GetStats();
+    if (accepted == 0 || accepted == queries.size()) {
+        throw logic_error("A full request queue must shed some but not all requests, accepted "s + to_string(accepted));
+    }
+    if (stats.requests != accepted || stats.rejected_requests != queries.size() - accepted
+        || stats.no_result_requests != no_result || no_result == 0) {
+        throw logic_error("Unexpected request queue counters"s);
+    }
+    if (stats.queue_depth != 0 || stats.max_latency_ns == 0 || stats.mean_latency_ns > stats.max_latency_ns) {
+        throw logic_error("Unexpected request queue latency or depth"s);
+    }
+
+    // The counters leave the window together with their buckets.
+    this_thread::sleep_for(options.bucket_duration * (options.bucket_count + 1));
+    const RequestQueueStats expired = request_queue.GetStats();
+    if (expired.requests != 0 || expired.rejected_requests != 0 || expired.no_result_requests != 0) {
+        throw logic_error("Request queue counters outlived the statistics window"s);
+    }
+}
+
+void TestWorkloadRoundTrip() {
+    const string path = (filesystem::temp_directory_path() / "search_server_test_workload.bin").string();
+    const auto read_file = [&] {
+        ifstream in(path, ios::binary);
+        return string{ istreambuf_iterator<char>(in), istreambuf_iterator<char>() };
+    };
+    const auto check_same = [](const vector<WorkloadQuery>& workload, const vector<WorkloadQuery>& expected, const string& hint) {
+        const bool same = equal(workload.begin(), workload.end(), expected.begin(), expected.end(),
+            [](const WorkloadQuery& lhs, const WorkloadQuery& rhs) {
+                return lhs.offset == rhs.offset && lhs.status == rhs.status && lhs.raw_query == rhs.raw_query;
+            });
+        if (!same) {
+            throw logic_error("Unexpected workload "s + hint);
+        }
+    };
+
+    // Deltas and sizes on both sides of every varint byte boundary.
+    vector<WorkloadQuery> workload;
+    const vector<int64_t> deltas = { 0, 1, 127, 128, 300, 16383, 16384, 2'000'000, int64_t{ 1 } << 40 };
+    chrono::microseconds offset{};
+    for (size_t i = 0; i < deltas.size(); ++i) {
+        offset += chrono::microseconds(deltas[i]);
+        workload.push_back({ offset, static_cast<DocumentStatus>(i % 4), string(i * i * 3, static_cast<char>('a' + i)) });
+    }
+    SaveWorkload(path, workload);
+    check_same(LoadWorkload(path), workload, "after a save"s);
+
+    // A record cut anywhere ends the workload after the last complete one.
+    const string data = read_file();
+    vector<size_t> record_ends;
+    for (size_t count = 0; count <= workload.size(); ++count) {
+        SaveWorkload(path, vector<WorkloadQuery>(workload.begin(), workload.begin() + count));
+        record_ends.push_back(filesystem::file_size(path));
+    }
+    for (size_t size = record_ends.front(); size <= data.size(); ++size) {
+        ofstream(path, ios::binary | ios::trunc) << data.substr(0, size);
+        const size_t count = upper_bound(record_ends.begin(), record_ends.end(), size) - record_ends.begin() - 1;
+        check_same(LoadWorkload(path), vector<WorkloadQuery>(workload.begin(), workload.begin() + count),
+            "cut at "s + to_string(size) + " bytes"s);
+    }
+
+    // A corrupt status and a missing magic are errors, not the end of the workload.
+    const vector<string> corrupt_files = { data.substr(0, record_ends.front()) + "\x05\x04\x00"s, "SSWKLD"s, "NOT A WORKLOAD"s };
+    for (const string& corrupt : corrupt_files) {
+        ofstream(path, ios::binary | ios::trunc) << corrupt;
+        try {
+            LoadWorkload(path);
+            throw logic_error("Corrupt workload accepted"s);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+
+    // Recorded offsets follow the clock; gaps longer than 127 us take several varint bytes.
+    {
+        WorkloadRecorder recorder(path);
+        for (size_t i = 0; i < 6; ++i) {
+            recorder.Record(workload[i].raw_query, workload[i].status);
+            this_thread::sleep_for(chrono::milliseconds(i));
+        }
+        if (recorder.GetRecordCount() != 6) {
+            throw logic_error("Unexpected number of recorded queries"s);
+        }
+    }
+    const vector<WorkloadQuery> recorded = LoadWorkload(path);
+    if (recorded.size() != 6) {
+        throw logic_error("Recorded workload has "s + to_string(recorded.size()) + " queries"s);
+    }
+    for (size_t i = 0; i < recorded.size(); ++i) {
+        if (recorded[i].status != workload[i].status || recorded[i].raw_query != workload[i].raw_query
+            || (i > 0 && recorded[i].offset - recorded[i - 1].offset < chrono::milliseconds(i - 1))) {
+            throw logic_error("Unexpected recorded query "s + to_string(i));
+        }
+    }
+    filesystem::remove(path);
+
+    // Over whole burst periods the arrival rate is mean_qps, steady or bursty;
+    // a burst factor of 10 leaves the quiet part of each period empty.
+    mt19937 generator(44);
+    const vector<string> vocabulary = GenerateVocabulary(50);
+    const ZipfDistribution distribution(vocabulary.size(), 1.0);
+    for (const double burst_factor : { 1.0, 4.0, 10.0 }) {
+        WorkloadShape shape;
+        shape.query_count = 20'000;
+        shape.mean_qps = 2000;
+        shape.burst_factor = burst_factor;
+        const vector<WorkloadQuery> generated = GenerateWorkload(generator, vocabulary, distribution, shape);
+        const auto periods = generated.back().offset / shape.burst_period;
+        const auto in_periods = count_if(generated.begin(), generated.end(), [&](const WorkloadQuery& query) {
+            return query.offset < periods * shape.burst_period;
+        });
+        const double qps = in_periods / chrono::duration<double>(periods * shape.burst_period).count();
+        if (abs(qps - shape.mean_qps) > 0.03 * shape.mean_qps) {
+            throw logic_error("Generated workload arrives at "s + to_string(qps) + " qps"s);
+        }
+    }
+}
+
+void TestDocumentSetMatchesStdSet() {
+    mt19937 generator(37);
+    // Three chunks, 8192 ids each: dense enough for bitmaps, sparse enough for arrays.
+    vector<int> domain;
+    for (const int base : { 0, 1 << 16, numeric_limits<int>::max() - 8191 }) {
+        for (int offset = 0; offset < 8192; ++offset) {
+            domain.push_back(base + offset);
+        }
+    }
+    const auto check_same = [&](const DocumentSet& documents, const set<int>& expected, const string& hint) {
+        if (documents.GetSize() != expected.size() || documents.IsEmpty() != expected.empty()) {
+            throw logic_error("DocumentSet has "s + to_string(documents.GetSize()) + " ids instead of "s
+                + to_string(expected.size()) + " "s + hint);
+        }
+        for (const int id : domain) {
+            if (documents.Contains(id) != (expected.count(id) != 0)) {
+                throw logic_error("DocumentSet disagrees on "s + to_string(id) + " "s + hint);
+            }
+        }
+    };
+    // Adds with add_probability, removes otherwise: a high one fills chunks past the
+    // array limit, a low one drains them back below half of it.
+    const auto mutate = [&](DocumentSet& documents, set<int>& expected, double add_probability) {
+        bernoulli_distribution add(add_probability);
+        uniform_int_distribution<size_t> pick(0, domain.size() - 1);
+        for (int i = 0; i < 60'000; ++i) {
+            const int id = domain[pick(generator)];
+            if (add(generator)) {
+                documents.Add(id);
+                expected.insert(id);
+            }
+            else {
+                documents.Remove(id);
+                expected.erase(id);
+            }
+        }
+    };
+
+    DocumentSet documents;
+    set<int> expected;
+    for (const double add_probability : { 0.9, 0.1, 0.8, 0.5, 0.05, 0.95, 0.0 }) {
+        mutate(documents, expected, add_probability);
+        check_same(documents, expected, "after mutations with add probability "s + to_string(add_probability));
+    }
+
+    // Unions of sparse and dense sets in both directions, then mutations of the result.
+    for (const double lhs_probability : { 0.1, 0.35, 0.9 }) {
+        for (const double rhs_probability : { 0.1, 0.35, 0.9 }) {
+            const string hint = "for a union of "s + to_string(lhs_probability) + " and "s + to_string(rhs_probability);
+            DocumentSet lhs;
+            set<int> lhs_expected;
+            mutate(lhs, lhs_expected, lhs_probability);
+            DocumentSet rhs;
+            set<int> rhs_expected;
+            mutate(rhs, rhs_expected, rhs_probability);
+            const DocumentSet rhs_copy(rhs, {});
+            lhs.UnionWith(rhs);
+            lhs_expected.insert(rhs_expected.begin(), rhs_expected.end());
+            check_same(lhs, lhs_expected, hint);
+            check_same(rhs, rhs_expected, "after being the argument "s + hint);
+            check_same(rhs_copy, rhs_expected, "in a copy "s + hint);
+            mutate(lhs, lhs_expected, 0.05);
+            check_same(lhs, lhs_expected, "after draining the result "s + hint);
+        }
+    }
+
+    documents.Clear();
+    check_same(documents, {}, "after Clear"s);
+}
+
+void TestMetricsHistogramAndShards() {
+    // Buckets tile the whole range: each lower bound maps back to its bucket, the
+    // value below it to the previous one, and a bucket spans at most 1/16 of its bound.
+    for (size_t index = 0; index < LatencyHistogram::BUCKET_COUNT; ++index) {
+        const uint64_t lower_bound = LatencyHistogram::GetBucketLowerBound(index);
+        if (LatencyHistogram::GetBucketIndex(lower_bound) != index
+            || (index > 0 && LatencyHistogram::GetBucketIndex(lower_bound - 1) != index - 1)) {
+            throw logic_error("Wrong bounds of histogram bucket "s + to_string(index));
+        }
+        if (index + 1 < LatencyHistogram::BUCKET_COUNT && index >= 2 * LatencyHistogram::SUB_BUCKETS
+            && (LatencyHistogram::GetBucketLowerBound(index + 1) - lower_bound) * LatencyHistogram::SUB_BUCKETS > lower_bound) {
+            throw logic_error("Histogram bucket "s + to_string(index) + " is too wide"s);
+        }
+    }
+    for (const uint64_t value : { uint64_t{ 1 } << 63, numeric_limits<uint64_t>::max() }) {
+        if (LatencyHistogram::GetBucketIndex(value) != LatencyHistogram::BUCKET_COUNT - 1) {
+            throw logic_error("Values from 2^63 up must go to the last histogram bucket"s);
+        }
+    }
+
+    // A percentile is the lower bound of the bucket holding the value of that rank.
+    mt19937 generator(28);
+    lognormal_distribution<double> distribution(10, 3);
+    vector<uint64_t> values;
+    LatencyHistogram histogram;
+    for (int i = 0; i < 10'000; ++i) {
+        values.push_back(static_cast<uint64_t>(distribution(generator)));
+        histogram.Record(values.back());
+    }
+    histogram.Record(numeric_limits<uint64_t>::max());
+    values.push_back(numeric_limits<uint64_t>::max());
+    HistogramSnapshot snapshot;
+    histogram.MergeInto(snapshot.buckets, snapshot.sum, snapshot.max);
+    snapshot.count = values.size();
+    sort(values.begin(), values.end());
+    for (const double p : { 0.0, 0.001, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0 }) {
+        const size_t rank = max<size_t>(1, static_cast<size_t>(ceil(p * values.size())));
+        const uint64_t value = values[rank - 1];
+        const uint64_t expected = LatencyHistogram::GetBucketLowerBound(LatencyHistogram::GetBucketIndex(value));
+        if (snapshot.Percentile(p) != expected || snapshot.Percentile(p) > value) {
+            throw logic_error("Wrong histogram percentile "s + to_string(p));
+        }
+    }
+    if (snapshot.max != values.back() || HistogramSnapshot{}.Percentile(0.5) != 0 || HistogramSnapshot{}.Mean() != 0) {
+        throw logic_error("Wrong histogram maximum or empty percentile"s);
+    }
+
+    // Threads that exit hand their shards to later threads, values included.
+    MetricsRegistry& registry = MetricsRegistry::Instance();
+    const auto record_on_new_thread = [&] {
+        thread([&] {
+            registry.Add(Counter::QUERIES, 1);
+            registry.Record(Timer::PROCESS_QUERIES, 1);
+        }).join();
+    };
+    record_on_new_thread();
+    const size_t shard_count = registry.GetShardCount();
+    const MetricsSnapshot before = registry.GetSnapshot();
+    for (int i = 0; i < 100; ++i) {
+        record_on_new_thread();
+    }
+    const MetricsSnapshot after = registry.GetSnapshot();
+    if (registry.GetShardCount() != shard_count) {
+        throw logic_error("Exited threads left "s + to_string(registry.GetShardCount() - shard_count) + " metrics shards behind"s);
+    }
+    const size_t queries = static_cast<size_t>(Counter::QUERIES);
+    const size_t process_queries = static_cast<size_t>(Timer::PROCESS_QUERIES);
+    if (after.counters[queries] - before.counters[queries] != 100
+        || after.timers[process_queries].count - before.timers[process_queries].count != 100) {
+        throw logic_error("Metrics of exited threads were lost"s);
+    }
+}
+
+void TestSearchCursorPagesMatchFullSearch() {
+    mt19937 generator(31);
+    const vector<string> vocabulary = GenerateVocabulary(40);
+    SearchServer search_server("w3"s);
+    // Distinct ratings leave no ties, so the full order is unique.
+    for (int id = 0; id < 500; ++id) {
+        search_server.AddDocument(id, GenerateText(generator, vocabulary, 10), DocumentStatus::ACTUAL, { id });
+    }
+    const size_t no_limit = numeric_limits<size_t>::max();
+
+    for (int i = 0; i < 20; ++i) {
+        const string query = GenerateText(generator, vocabulary, 3) + (i % 3 == 0 ? " -w1"s : ""s);
+        const vector<Document> all = search_server.OpenSearchCursor(query, no_limit).NextPage();
+        if (!is_sorted(all.begin(), all.end(), SearchServer::IsMoreRelevant)) {
+            throw logic_error("Unordered results for "s + query);
+        }
+        const vector<Document> top = search_server.FindTopDocuments(query);
+        CheckSameDocuments(vector<Document>(all.begin(), all.begin() + min(all.size(), top.size())), top, query);
+        if (top.size() < min<size_t>(all.size(), MAX_RESULT_DOCUMENT_COUNT)) {
+            throw logic_error("FindTopDocuments returned too few results for "s + query);
+        }
+
+        for (const size_t page_size : { size_t{ 1 }, size_t{ 3 }, size_t{ 7 }, size_t{ 64 }, all.size() + 1, no_limit }) {
+            const string hint = query + " in pages of "s + to_string(page_size);
+            SearchCursor cursor = search_server.OpenSearchCursor(query, page_size);
+            vector<Document> pages;
+            size_t page_count = 0;
+            while (cursor.HasMore()) {
+                const vector<Document> page = cursor.NextPage();
+                pages.insert(pages.end(), page.begin(), page.end());
+                ++page_count;
+            }
+            CheckSameDocuments(pages, all, hint);
+            if (page_count != cursor.GetPageCount() || !cursor.NextPage().empty() || cursor.HasMore()) {
+                throw logic_error("Unexpected pages for "s + hint);
+            }
+
+            // Pages far past the end are empty, even where index * page_size wraps around.
+            const size_t wrapping_page = page_size > 1 ? no_limit / page_size + 1 : no_limit;
+            for (const size_t page_index : { no_limit, wrapping_page, cursor.GetPageCount() }) {
+                if (!cursor.GetPage(page_index).empty() || cursor.HasMore()) {
+                    throw logic_error("Page "s + to_string(page_index) + " is past the end for "s + hint);
+                }
+            }
+            if (cursor.GetPageCount() > 1) {
+                const size_t last_page = cursor.GetPageCount() - 1;
+                CheckSameDocuments(cursor.GetPage(last_page),
+                    vector<Document>(all.begin() + last_page * page_size, all.end()), "the last page of "s + hint);
+                CheckSameDocuments(cursor.GetPage(0), vector<Document>(all.begin(), all.begin() + page_size),
+                    "the first page of "s + hint);
+                if (!cursor.HasMore()) {
+                    throw logic_error("No more pages after the first one for "s + hint);
+                }
+            }
+        }
+    }
+}
+
+void TestQueryProfileMatchesBruteForce() {
+    mt19937 generator(29);
+    const vector<string> vocabulary = GenerateVocabulary(20);
+    SearchServer search_server(""s);
+    vector<set<string>> document_words;
+    for (int id = 0; id < 300; ++id) {
+        const string text = GenerateText(generator, vocabulary, 8);
+        const DocumentStatus status = id % 4 == 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        search_server.AddDocument(id, text, status, { id });
+        set<string> words;
+        for (const string_view word : SplitIntoWords(text)) {
+            words.emplace(word);
+        }
+        document_words.push_back(move(words));
+    }
+    const auto contains = [&](int id, const string& term) {
+        if (term.back() != '*') {
+            return document_words[id].count(term) != 0;
+        }
+        const string prefix = term.substr(0, term.size() - 1);
+        const auto it = document_words[id].lower_bound(prefix);
+        return it != document_words[id].end() && it->compare(0, prefix.size(), prefix) == 0;
+    };
+    const auto is_actual = [](int id) {
+        return id % 4 != 3;
+    };
+
+    // The query text is overwritten before the profile is read: terms must not point into it.
+    const vector<string> plus_terms = { "w4"s, "w7"s, "missing"s, "w1*"s };
+    const string minus_term = "w2"s;
+    string query = "w4 w7 missing w1* -w2"s;
+    QueryProfile profile;
+    const vector<Document> documents = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, profile);
+    CheckSameDocuments(documents, search_server.FindTopDocuments(query), query);
+    query.assign(query.size(), 'x');
+
+    size_t candidates = 0;
+    size_t removed = 0;
+    for (int id = 0; id < static_cast<int>(document_words.size()); ++id) {
+        if (is_actual(id) && any_of(plus_terms.begin(), plus_terms.end(), [&](const string& term) { return contains(id, term); })) {
+            ++candidates;
+            removed += contains(id, minus_term);
+        }
+    }
+    if (profile.candidates != candidates || profile.removed_by_minus_words != removed
+        || profile.results != documents.size() || documents.size() != min<size_t>(candidates - removed, MAX_RESULT_DOCUMENT_COUNT)) {
+        throw logic_error("Unexpected query profile totals"s);
+    }
+    if (profile.terms.size() != plus_terms.size() + 1) {
+        throw logic_error("Unexpected number of profiled terms"s);
+    }
+    for (const string& term : plus_terms) {
+        const string word = term.back() == '*' ? term.substr(0, term.size() - 1) : term;
+        const auto profiled = find_if(profile.terms.begin(), profile.terms.end(), [&](const TermProfile& term_profile) {
+            return term_profile.word == word && !term_profile.is_minus;
+        });
+        size_t postings = 0;
+        size_t kept = 0;
+        for (int id = 0; id < static_cast<int>(document_words.size()); ++id) {
+            postings += contains(id, term);
+            kept += contains(id, term) && is_actual(id) && !contains(id, minus_term);
+        }
+        if (profiled == profile.terms.end() || profiled->postings != postings || profiled->kept != kept
+            || profiled->rejected != postings - kept || (postings > 0) != (profiled->inverse_document_freq > 0)) {
+            throw logic_error("Unexpected profile of term "s + term);
+        }
+    }
+    const TermProfile& minus_profile = *find_if(profile.terms.begin(), profile.terms.end(), [](const TermProfile& term) {
+        return term.is_minus;
+    });
+    if (minus_profile.word != minus_term || minus_profile.rejected != removed
+        || minus_profile.kept + minus_profile.rejected != minus_profile.postings) {
+        throw logic_error("Unexpected profile of the minus word"s);
+    }
+    ostringstream printed;
+    printed << profile;
+    if (printed.str().find("  -w2: postings = "s + to_string(minus_profile.postings)) == string::npos
+        || printed.str().find("  w1: postings = "s) == string::npos) {
+        throw logic_error("Unexpected printed profile:\n"s + printed.str());
+    }
+
+    // MatchDocument profiles one document: a term is kept when the document has it.
+    for (int id = 0; id < 20; ++id) {
+        query = "w4 w7 -w2"s;
+        QueryProfile match_profile;
+        const auto [matched_words, status] = search_server.MatchDocument(query, id, match_profile);
+        query.assign(query.size(), 'x');
+        const bool excluded = contains(id, minus_term);
+        const size_t expected_matches = excluded ? 0 : contains(id, "w4"s) + contains(id, "w7"s);
+        if (match_profile.results != expected_matches || matched_words.size() != expected_matches
+            || match_profile.removed_by_minus_words != (excluded ? 1u : 0u) || match_profile.terms.size() != 3) {
+            throw logic_error("Unexpected match profile of document "s + to_string(id));
+        }
+        for (const TermProfile& term : match_profile.terms) {
+            const bool has_term = contains(id, term.word);
+            if ((term.word != "w4"s && term.word != "w7"s && term.word != minus_term)
+                || term.is_minus != (term.word == minus_term) || (term.is_minus ? term.rejected : term.kept) != (has_term ? 1u : 0u)) {
+                throw logic_error("Unexpected match profile of "s + term.word + " in document "s + to_string(id));
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// Throws logic_error if a warmed-up QueryContext query allocates from the heap.
+void TestQueryContextDoesNotAllocate();
+
+// Prefix and typo expansion after the last document containing a word is removed,
+// sequentially and in parallel.
+void TestPrefixSearchAfterRemoval();
+
+// A ShardedSearchServer filled by concurrent writers returns what a single
+// SearchServer with the same documents does, under TF-IDF and BM25.
+void TestShardedSearchMatchesSingleServer();
+
+// The positional and typo indexes are counted in GetMemoryStats.
+void TestMemoryStatsCoverAllIndexes();
+
+// Submitted requests are answered across idle periods, and idle workers sleep
+// instead of polling.
+void TestRequestQueueWorkersSleepWhenIdle();
+
+// Stop-word tables: constant-evaluated and runtime construction, duplicate words,
+// and a large list that used to take quadratic time to build.
+void TestStopWordsTable();
+
+// Quoted phrases, with and without the positional index, against a scan of the
+// document texts.
+void TestPhraseQueriesMatchBruteForce();
+
+// Pipelined requests to a QueryService on a loopback socket are answered in order,
+// as direct calls to a SearchServer would be, and all of them before a half-closed
+// connection is closed.
+void TestQueryServiceAnswersInOrder();
+
+// Typo index lookups against the edit distance to every term, and the scoring of
+// typo matches in the server.
+void TestTypoSuggestionsMatchBruteForce();
+
+// BM25 relevance and result order against the Okapi formula computed from the
+// document texts.
+void TestBm25OrderingMatchesFormula();
+
+// Conjunctive queries and +word required terms against an intersection computed
+// from the document texts.
+void TestRequiredWordsMatchIntersection();
+
+// UpdateDocument leaves the same inverted, positional and typo indexes and the same
+// texts as removing the document and adding it again.
+void TestUpdateDocumentMatchesRemoveAndAdd();
+
+// Mutation log replay against applying the same calls directly, including torn
+// tails, corrupt records, a partial magic, truncation and failed writes.
+void TestMutationLogRecovery();
+
+// ParseCorpus on a multi-chunk corpus with mixed line endings, and LoadCorpus,
+// against a sequential AddDocument load.
+void TestCorpusLoaderMatchesSequentialLoad();
+
+// TrySubmit on a full queue rejects requests, and the windowed counters account
+// for accepted, empty and rejected requests until they expire.
+void TestRequestQueueShedsLoadWhenFull();
+
+// Workload files through save, load, truncation, corruption and the recorder,
+// and the average arrival rate of generated workloads.
+void TestWorkloadRoundTrip();
+
+// Random adds, removes and unions against std::set, dense enough to convert
+// chunks between arrays and bitmaps both ways.
+void TestDocumentSetMatchesStdSet();
+
+// Histogram bucket bounds and percentiles against sorted values, and metrics
+// shards of exited threads being reused without losing their values.
+void TestMetricsHistogramAndShards();
+
+// Search cursor pages, concatenated, against one unlimited page; pages past the
+// end, including indexes whose offset overflows, are empty.
+void TestSearchCursorPagesMatchFullSearch();
+
+// Profiled FindTopDocuments and MatchDocument against counts taken from the
+// document texts, with the query text overwritten before the profile is read.
+void TestQueryProfileMatchesBruteForce();
@@ -0,0 +1,178 @@
+#include "typo_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace std::literals;
+
+TypoIndex::TypoIndex(int max_distance, size_t prefix_length, pmr::memory_resource* memory)
+    : max_distance_(max_distance)
+    , prefix_length_(prefix_length)
+    , terms_(memory)
+    , free_ids_(memory)
+    , term_ids_(memory)
+    , deletes_(memory) {
+    if (max_distance < 0 || max_distance > MAX_DISTANCE) {
+        throw invalid_argument("Typo distance must be between 0 and 2"s);
+    }
+    if (prefix_length <= static_cast<size_t>(max_distance)) {
+        throw invalid_argument("Typo index prefix is too short"s);
+    }
+}
+
+void TypoIndex::AddTerm(string_view term) {
+    if (term_ids_.count(term) > 0) {
+        return;
+    }
+    uint32_t id = static_cast<uint32_t>(terms_.size());
+    if (free_ids_.empty()) {
+        terms_.push_back(term);
+    }
+    else {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+        terms_[id] = term;
+    }
+    term_ids_.emplace(term, id);
+
+    const auto length = static_cast<uint8_t>(min<size_t>(term.size(), UINT8_MAX));
+    vector<pair<uint64_t, int>> hashes;
+    CollectDeleteHashes(term, max_distance_, hashes);
+    for (const auto& [hash, deletions] : hashes) {
+        deletes_[hash].push_back({ id, length, static_cast<uint8_t>(deletions) });
+    }
+}
+
+void TypoIndex::RemoveTerm(string_view term) {
+    const auto it = term_ids_.find(term);
+    if (it == term_ids_.end()) {
+        return;
+    }
+    const uint32_t id = it->second;
+    term_ids_.erase(it);
+
+    vector<pair<uint64_t, int>> hashes;
+    CollectDeleteHashes(term, max_distance_, hashes);
+    for (const auto& [hash, _] : hashes) {
+        auto& entries = deletes_.at(hash);
+        entries.erase(find_if(entries.begin(), entries.end(), [id](const Entry& entry) { return entry.id == id; }));
+        if (entries.empty()) {
+            deletes_.erase(hash);
+        }
+    }
+    terms_[id] = string_view();
+    free_ids_.push_back(id);
+}
+
+void TypoIndex::FindTerms(string_view word, int max_distance, vector<pair<string_view, int>>& terms) const {
+    max_distance = min({ max_distance, max_distance_, GetAllowedDistance(word.size()) });
+    if (max_distance <= 0) {
+        return;
+    }
+
+    const int word_length = static_cast<int>(min<size_t>(word.size(), UINT8_MAX));
+    vector<pair<uint64_t, int>> hashes;
+    CollectDeleteHashes(word, max_distance, hashes);
+    vector<uint32_t> candidates;
+    for (const auto& [hash, _] : hashes) {
+        const auto it = deletes_.find(hash);
+        if (it == deletes_.end()) {
+            continue;
+        }
+        // Words within the distance meet on a key reached by at most that many
+        // deletions from either side.
+        for (const Entry& entry : it->second) {
+            if (entry.deletions <= max_distance && abs(entry.length - word_length) <= max_distance) {
+                candidates.push_back(entry.id);
+            }
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (const uint32_t id : candidates) {
+        const string_view term = terms_[id];
+        const int distance = ComputeDistance(word, term, max_distance);
+        if (distance > 0 && distance <= max_distance) {
+            terms.emplace_back(term, distance);
+        }
+    }
+}
+
+size_t TypoIndex::GetTermCount() const {
+    return term_ids_.size();
+}
+
+int TypoIndex::GetAllowedDistance(size_t word_length) {
+    return word_length <= 2 ? 0 : word_length <= 5 ? 1 : 2;
+}
+
+int TypoIndex::ComputeDistance(string_view lhs, string_view rhs, int max_distance) {
+    // Three rolling rows of the OSA matrix, on the stack for dictionary-sized words.
+    // A row whose minimum is already over the bound cannot lead to a smaller distance.
+    constexpr size_t STACK_WORD_LENGTH = 64;
+    int stack_rows[3][STACK_WORD_LENGTH + 1];
+    vector<int> heap_rows;
+    int* before_previous = stack_rows[0];
+    int* previous = stack_rows[1];
+    int* current = stack_rows[2];
+    if (rhs.size() > STACK_WORD_LENGTH) {
+        heap_rows.resize(3 * (rhs.size() + 1));
+        before_previous = heap_rows.data();
+        previous = before_previous + rhs.size() + 1;
+        current = previous + rhs.size() + 1;
+    }
+
+    for (size_t j = 0; j <= rhs.size(); ++j) {
+        previous[j] = static_cast<int>(j);
+    }
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = static_cast<int>(i);
+        int row_minimum = current[0];
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            const int cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+            current[j] = min({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost });
+            if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1]) {
+                current[j] = min(current[j], before_previous[j - 2] + 1);
+            }
+            row_minimum = min(row_minimum, current[j]);
+        }
+        if (row_minimum > max_distance) {
+            return max_distance + 1;
+        }
+        int* const oldest = before_previous;
+        before_previous = previous;
+        previous = current;
+        current = oldest;
+    }
+    return min(previous[rhs.size()], max_distance + 1);
+}
+
+void TypoIndex::CollectDeleteHashes(string_view word, int max_distance, vector<pair<uint64_t, int>>& hashes) const {
+    const string prefix(word.substr(0, prefix_length_));
+    const hash<string_view> hasher;
+    hashes.emplace_back(hasher(prefix), 0);
+
+    // Breadth-first over deletion counts; each level deletes one more character.
+    vector<string> level = { prefix };
+    for (int distance = 1; distance <= max_distance; ++distance) {
+        vector<string> next_level;
+        for (const string& variant : level) {
+            for (size_t i = 0; i < variant.size(); ++i) {
+                string shorter = variant;
+                shorter.erase(i, 1);
+                next_level.push_back(move(shorter));
+            }
+        }
+        sort(next_level.begin(), next_level.end());
+        next_level.erase(unique(next_level.begin(), next_level.end()), next_level.end());
+        for (const string& variant : next_level) {
+            hashes.emplace_back(hasher(variant), distance);
+        }
+        level = move(next_level);
+    }
+    sort(hashes.begin(), hashes.end());
+    hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Symmetric-delete index over the term dictionary. Every term is filed under the
+// hashes of all strings obtained by deleting up to max_distance characters from its
+// first prefix_length characters. A query word is looked up under its own deletions,
+// so two words within the distance always meet on some key; the candidates are then
+// verified by the actual edit distance. Lookup cost depends on the word length, not
+// on the vocabulary size.
+class TypoIndex {
+public:
+    static constexpr int MAX_DISTANCE = 2;
+    static constexpr size_t DEFAULT_PREFIX_LENGTH = 7;
+
+    explicit TypoIndex(int max_distance = MAX_DISTANCE, size_t prefix_length = DEFAULT_PREFIX_LENGTH,
+        pmr::memory_resource* memory = pmr::get_default_resource());
+
+    // The view must stay valid while the term is in the index.
+    void AddTerm(string_view term);
+    void RemoveTerm(string_view term);
+
+    // Terms at distance 1..max_distance from word, appended to terms together with
+    // their distance. The distance is also capped by the index's own and by
+    // GetAllowedDistance(word.size()).
+    void FindTerms(string_view word, int max_distance, vector<pair<string_view, int>>& terms) const;
+
+    size_t GetTermCount() const;
+
+    // No typos in words of up to 2 characters, one up to 5, two beyond: a short word
+    // is within distance 2 of a large part of any vocabulary.
+    static int GetAllowedDistance(size_t word_length);
+
+    // Optimal string alignment distance: insertions, deletions, substitutions and
+    // transpositions of adjacent characters. Returns max_distance + 1 once it is exceeded.
+    static int ComputeDistance(string_view lhs, string_view rhs, int max_distance);
+
+private:
+    // Length and deletion count let lookups drop most candidates without
+    // touching the term itself.
+    struct Entry {
+        uint32_t id;
+        uint8_t length;
+        uint8_t deletions;
+    };
+
+    int max_distance_;
+    size_t prefix_length_;
+    pmr::vector<string_view> terms_;
+    pmr::vector<uint32_t> free_ids_;
+    pmr::unordered_map<string_view, uint32_t> term_ids_;
+    pmr::unordered_map<uint64_t, pmr::vector<Entry>> deletes_;
+
+    // Hashes of the prefix itself and of all its deletions, with the number of
+    // characters deleted, without duplicates.
+    void CollectDeleteHashes(string_view word, int max_distance, vector<pair<uint64_t, int>>& hashes) const;
+};
@@ -0,0 +1,213 @@
+#include "workload.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+#include "search_server.h"
+
+namespace {
+
+constexpr string_view MAGIC = "SSWKLD01"sv;
+constexpr size_t FLUSH_SIZE = 1 << 16;
+
+void PutVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool GetVarint(string_view& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PutRecord(string& out, chrono::microseconds delta, DocumentStatus status, string_view raw_query) {
+    PutVarint(out, static_cast<uint64_t>(delta.count()));
+    out.push_back(static_cast<char>(status));
+    PutVarint(out, raw_query.size());
+    out += raw_query;
+}
+
+}  // namespace
+
+WorkloadRecorder::WorkloadRecorder(const string& path)
+    : out_(path, ios::binary | ios::trunc)
+    , start_(Clock::now()) {
+    if (!out_) {
+        throw runtime_error("Cannot open "s + path);
+    }
+    out_ << MAGIC;
+}
+
+WorkloadRecorder::~WorkloadRecorder() {
+    Flush();
+}
+
+void WorkloadRecorder::Record(string_view raw_query, DocumentStatus status) {
+    lock_guard lock(mutex_);
+    // Taken under the lock, so that offsets never go back.
+    const auto offset = chrono::duration_cast<chrono::microseconds>(Clock::now() - start_);
+    PutRecord(buffer_, offset - last_offset_, status, raw_query);
+    last_offset_ = offset;
+    ++records_;
+    if (buffer_.size() >= FLUSH_SIZE) {
+        out_.write(buffer_.data(), static_cast<streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void WorkloadRecorder::Flush() {
+    lock_guard lock(mutex_);
+    out_.write(buffer_.data(), static_cast<streamsize>(buffer_.size()));
+    out_.flush();
+    buffer_.clear();
+}
+
+size_t WorkloadRecorder::GetRecordCount() const {
+    lock_guard lock(mutex_);
+    return records_;
+}
+
+// A record cut short by a crash of the recording process ends the workload.
+vector<WorkloadQuery> LoadWorkload(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("Cannot open "s + path);
+    }
+    const string data{ istreambuf_iterator<char>(in), istreambuf_iterator<char>() };
+    if (string_view(data).substr(0, MAGIC.size()) != MAGIC) {
+        throw invalid_argument("Not a workload file: "s + path);
+    }
+
+    vector<WorkloadQuery> workload;
+    string_view rest = string_view(data).substr(MAGIC.size());
+    chrono::microseconds offset{};
+    while (!rest.empty()) {
+        uint64_t delta = 0;
+        uint64_t size = 0;
+        if (!GetVarint(rest, delta) || rest.empty()) {
+            break;
+        }
+        const auto status = static_cast<uint8_t>(rest.front());
+        rest.remove_prefix(1);
+        if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+            throw invalid_argument("Invalid document status in "s + path);
+        }
+        if (!GetVarint(rest, size) || rest.size() < size) {
+            break;
+        }
+        offset += chrono::microseconds(delta);
+        workload.push_back({ offset, static_cast<DocumentStatus>(status), string(rest.substr(0, size)) });
+        rest.remove_prefix(size);
+    }
+    return workload;
+}
+
+void SaveWorkload(const string& path, const vector<WorkloadQuery>& workload) {
+    string data(MAGIC);
+    chrono::microseconds last_offset{};
+    for (const WorkloadQuery& query : workload) {
+        PutRecord(data, query.offset - last_offset, query.status, query.raw_query);
+        last_offset = query.offset;
+    }
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.write(data.data(), static_cast<streamsize>(data.size()))) {
+        throw runtime_error("Cannot write "s + path);
+    }
+}
+
+vector<WorkloadQuery> GenerateWorkload(mt19937& generator, const vector<string>& dictionary,
+    const ZipfDistribution& distribution, const WorkloadShape& shape) {
+    const double period = chrono::duration<double>(shape.burst_period).count();
+    const double burst = chrono::duration<double>(shape.burst_duration).count();
+    const bool bursty = period > burst && burst > 0;
+    const double burst_rate = shape.mean_qps * shape.burst_factor;
+    // Chosen so that the average rate over a period is mean_qps.
+    const double quiet_rate = bursty ? shape.mean_qps * (period - shape.burst_factor * burst) / (period - burst) : 0;
+
+    vector<WorkloadQuery> workload;
+    workload.reserve(shape.query_count);
+    double time = 0;
+    for (int i = 0; i < shape.query_count; ++i) {
+        workload.push_back({ chrono::microseconds(llround(time * 1e6)), DocumentStatus::ACTUAL,
+            GenerateZipfQuery(generator, dictionary, distribution, shape.words_per_query, shape.minus_prob) });
+
+        double rate = shape.mean_qps;
+        if (bursty) {
+            rate = fmod(time, period) < burst ? burst_rate : quiet_rate;
+            if (rate <= 0) {
+                // Bursts carry the whole load: wait for the next one.
+                time = (floor(time / period) + 1) * period;
+                rate = burst_rate;
+            }
+        }
+        time += exponential_distribution<>(rate)(generator);
+    }
+    return workload;
+}
+
+WorkloadReplayStats ReplayWorkload(const SearchServer& search_server, const vector<WorkloadQuery>& workload,
+    const WorkloadReplayOptions& options) {
+    using Clock = chrono::steady_clock;
+    const size_t clients = max<size_t>(1, options.clients);
+
+    vector<Clock::duration> arrivals(workload.size());
+    for (size_t i = 0; i < workload.size(); ++i) {
+        const chrono::duration<double> arrival = options.qps > 0
+            ? chrono::duration<double>(i / options.qps)
+            : chrono::duration<double>(workload[i].offset) / options.speed;
+        arrivals[i] = chrono::duration_cast<Clock::duration>(arrival);
+    }
+
+    vector<double> latencies(workload.size());
+    vector<Clock::time_point> finished(clients);
+    atomic<size_t> empty_results = 0;
+    // Leaves the clients time to start before the first arrival.
+    const Clock::time_point start = Clock::now() + chrono::milliseconds(10);
+    vector<thread> threads;
+    threads.reserve(clients);
+    for (size_t client = 0; client < clients; ++client) {
+        threads.emplace_back([&, client] {
+            size_t empty = 0;
+            finished[client] = start;
+            for (size_t i = client; i < workload.size(); i += clients) {
+                const Clock::time_point arrival = start + arrivals[i];
+                this_thread::sleep_until(arrival);
+                try {
+                    empty += search_server.FindTopDocuments(workload[i].raw_query, workload[i].status).empty();
+                }
+                catch (const invalid_argument&) {
+                    // Invalid queries are part of real traffic; they count as empty.
+                    ++empty;
+                }
+                finished[client] = Clock::now();
+                latencies[i] = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(finished[client] - arrival).count());
+            }
+            empty_results += empty;
+        });
+    }
+    for (thread& thread : threads) {
+        thread.join();
+    }
+
+    WorkloadReplayStats stats;
+    stats.duration = *max_element(finished.begin(), finished.end()) - start;
+    stats.latency = ComputeBenchmarkStats(move(latencies), 1);
+    const double seconds = chrono::duration<double>(stats.duration).count();
+    stats.throughput_qps = seconds > 0 ? workload.size() / seconds : 0;
+    stats.empty_results = empty_results;
+    return stats;
+}
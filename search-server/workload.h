@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "benchmark.h"
+#include "document.h"
+#include "generators.h"
+
+using namespace std;
+
+class SearchServer;
+
+// One query of a workload, with its arrival time relative to the first query.
+struct WorkloadQuery {
+    chrono::microseconds offset{};
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    string raw_query;
+};
+
+// Workload files are an 8-byte magic followed by records
+//     <varint offset delta in microseconds> <uint8 status> <varint size> <query>
+// so that a captured stream costs little more than its text.
+
+// Captures the query stream passing through a RequestQueue or ProcessQueries.
+// Thread-safe; records are buffered and written in blocks.
+class WorkloadRecorder {
+public:
+    explicit WorkloadRecorder(const string& path);
+    // Writes what is still buffered.
+    ~WorkloadRecorder();
+
+    WorkloadRecorder(const WorkloadRecorder&) = delete;
+    WorkloadRecorder& operator=(const WorkloadRecorder&) = delete;
+
+    // Stamps the query with the current time.
+    void Record(string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+    void Flush();
+    size_t GetRecordCount() const;
+
+private:
+    using Clock = chrono::steady_clock;
+
+    mutable mutex mutex_;
+    ofstream out_;
+    string buffer_;
+    Clock::time_point start_;
+    chrono::microseconds last_offset_{};
+    size_t records_ = 0;
+};
+
+vector<WorkloadQuery> LoadWorkload(const string& path);
+void SaveWorkload(const string& path, const vector<WorkloadQuery>& workload);
+
+// Zipfian queries arriving at mean_qps on average, in bursts: arrivals form a
+// Poisson process whose rate alternates between burst_factor * mean_qps for
+// burst_duration and a lower rate for the rest of every burst_period.
+struct WorkloadShape {
+    int query_count = 10'000;
+    int words_per_query = 3;
+    double minus_prob = 0.1;
+    double mean_qps = 1000;
+    double burst_factor = 4;
+    chrono::milliseconds burst_duration{ 100 };
+    chrono::milliseconds burst_period{ 1000 };
+};
+
+vector<WorkloadQuery> GenerateWorkload(mt19937& generator, const vector<string>& dictionary,
+    const ZipfDistribution& distribution, const WorkloadShape& shape);
+
+struct WorkloadReplayOptions {
+    // Requests per second over all clients, evenly spaced; 0 keeps the recorded
+    // arrival times, scaled by speed.
+    double qps = 0;
+    double speed = 1;
+    size_t clients = max(1u, thread::hardware_concurrency());
+};
+
+struct WorkloadReplayStats {
+    // Measured from the scheduled arrival, not from the actual send, so that a
+    // client that falls behind shows up as latency instead of as a lower load.
+    BenchmarkStats latency;
+    chrono::nanoseconds duration{};
+    double throughput_qps = 0;
+    size_t empty_results = 0;
+};
+
+// Open-loop replay: every query is issued at its own arrival time, whether or not
+// earlier ones have completed. Query i goes to client i % clients.
+WorkloadReplayStats ReplayWorkload(const SearchServer& search_server, const vector<WorkloadQuery>& workload,
+    const WorkloadReplayOptions& options = {});